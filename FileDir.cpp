@@ -31,6 +31,7 @@
 //
 
 #include "FileDir.h"
+#include "FileDirPath.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -44,12 +45,10 @@
 
 #ifdef _WIN32
 #define FILEDIR_CHAR wchar_t
-#define ustrrchr wcsrchr
 #define ustrlen wcslen
 #define ustrdup _wcsdup
 #else
 #define FILEDIR_CHAR char
-#define ustrrchr strrchr
 #define ustrlen strlen
 #define ustrdup strdup
 #endif
@@ -59,10 +58,55 @@
 FileDir::FileDir(void)
 {
 	_fullPath = NULL;
-	_fileName = NULL;
+	_fullPathCapacity = _fullPathLength = _fileNameOffset = 0;
 	_cachedExtension = _cachedFileNameWithoutExtension = _cachedBasePath = NULL;
 	_isFolder = _isFile = false;
 	_hasTimes = false;
+	_size = -1;
+}
+
+FileDir::FileDir(FileDir &&other) noexcept
+{
+	_fullPath = NULL;
+	_fullPathCapacity = _fullPathLength = _fileNameOffset = 0;
+	_cachedExtension = _cachedFileNameWithoutExtension = _cachedBasePath = NULL;
+
+	*this = static_cast<FileDir &&>(other);
+}
+
+FileDir & FileDir::operator=(FileDir &&other) noexcept
+{
+	if (this == &other) return *this;
+
+	free(_fullPath);
+	ReleaseCache();
+
+	_fullPath = other._fullPath;
+	_fullPathCapacity = other._fullPathCapacity;
+	_fullPathLength = other._fullPathLength;
+	_fileNameOffset = other._fileNameOffset;
+	_isFolder = other._isFolder;
+	_isFile = other._isFile;
+	_hasTimes = other._hasTimes;
+	_size = other._size;
+	_creationTime = other._creationTime;
+	_lastModificationTime = other._lastModificationTime;
+	_lastAccessTime = other._lastAccessTime;
+	_lastStatusChangeTime = other._lastStatusChangeTime;
+
+	// The cached extension points into _fullPath, which moves along with it
+	_cachedExtension = other._cachedExtension;
+	_cachedFileNameWithoutExtension = other._cachedFileNameWithoutExtension;
+	_cachedBasePath = other._cachedBasePath;
+
+	other._fullPath = NULL;
+	other._fullPathCapacity = other._fullPathLength = other._fileNameOffset = 0;
+	other._cachedExtension = other._cachedFileNameWithoutExtension = other._cachedBasePath = NULL;
+	other._isFolder = other._isFile = false;
+	other._hasTimes = false;
+	other._size = -1;
+
+	return *this;
 }
 
 FileDir::~FileDir(void)
@@ -73,12 +117,6 @@ FileDir::~FileDir(void)
 		_fullPath = NULL;
 	}
 
-	if (_fileName)
-	{
-		free(_fileName);
-		_fileName = NULL;
-	}
-
 	if (_cachedFileNameWithoutExtension)
 	{
 		free(_cachedFileNameWithoutExtension);
@@ -96,18 +134,73 @@ FileDir::~FileDir(void)
 
 void FileDir::SetFullPath(const FILEDIR_CHAR *fullPath)
 {
-	if (_fullPath)
+	bool isFolder = _isFolder, isFile = _isFile;
+
+	if (fullPath)
+	{
+		int fullPathLength = (int)ustrlen(fullPath);
+		Assign(fullPath, fullPathLength, FileDirPath::GetFileNameOffset(fullPath, fullPathLength));
+	}
+	else
 	{
 		free(_fullPath);
 		_fullPath = NULL;
+		_fullPathCapacity = _fullPathLength = _fileNameOffset = 0;
+
+		ReleaseCache();
+
+		_hasTimes = false;
+		_size = -1;
 	}
 
-	if (_fileName)
+	_isFolder = isFolder;
+	_isFile = isFile;
+}
+
+void FileDir::Reserve(int fullPathLength)
+{
+	if (_fullPathCapacity < fullPathLength + 1)
 	{
-		free(_fileName);
-		_fileName = NULL;
+		// Round up, so a stream of paths of slightly growing length settles after a few entries
+		free(_fullPath);
+		_fullPathCapacity = (fullPathLength + 1 + 63) & ~63;
+		_fullPath = (FILEDIR_CHAR *)malloc(sizeof(FILEDIR_CHAR) * _fullPathCapacity);
 	}
+}
+
+void FileDir::Assign(const FILEDIR_CHAR *fullPath, int fullPathLength, int fileNameOffset)
+{
+	// A part of our own path always fits, so Reserve() keeps the buffer and memmove() handles the overlap
+	Reserve(fullPathLength);
+	memmove(_fullPath, fullPath, sizeof(FILEDIR_CHAR) * fullPathLength);
+	_fullPath[fullPathLength] = '\0';
+	_fullPathLength = fullPathLength;
+	_fileNameOffset = fileNameOffset;
+
+	ReleaseCache();
 
+	_isFolder = _isFile = false;
+	_hasTimes = false;
+	_size = -1;
+}
+
+void FileDir::AssignJoined(const FILEDIR_CHAR *folder, int folderLength, const FILEDIR_CHAR *name, int nameLength)
+{
+	int fullPathLength = FileDirPath::Join(NULL, 0, folder, folderLength, name, nameLength);
+	Reserve(fullPathLength);
+	FileDirPath::Join(_fullPath, _fullPathCapacity, folder, folderLength, name, nameLength);
+	_fullPathLength = fullPathLength;
+	_fileNameOffset = fullPathLength - nameLength;
+
+	ReleaseCache();
+
+	_isFolder = _isFile = false;
+	_hasTimes = false;
+	_size = -1;
+}
+
+void FileDir::ReleaseCache()
+{
 	if (_cachedFileNameWithoutExtension)
 	{
 		free(_cachedFileNameWithoutExtension);
@@ -121,28 +214,6 @@ void FileDir::SetFullPath(const FILEDIR_CHAR *fullPath)
 	}
 
 	_cachedExtension = NULL;
-
-	_hasTimes = false;
-
-	if (fullPath)
-	{
-		_fullPath = ustrdup(fullPath);
-
-		const FILEDIR_CHAR *separator = ustrrchr(_fullPath, '/');
-		if (!separator) separator = ustrrchr(_fullPath, '\\');
-		if (separator && separator[1] == '\0')
-		{
-			while (separator > _fullPath && --separator && (separator[0] != '/' && separator[0] != '\\'));
-		}
-		if (separator && !(separator == _fullPath && separator[1] == '\0'))
-		{
-			_fileName = ustrdup(separator + 1);
-		}
-		else 
-		{
-			_fileName = ustrdup(_fullPath);
-		}
-	}
 }
 
 const FILEDIR_CHAR * FileDir::GetExtension()
@@ -151,15 +222,8 @@ const FILEDIR_CHAR * FileDir::GetExtension()
 
 	if (!_cachedExtension)
 	{
-		FILEDIR_CHAR *period = ustrrchr(_fullPath, '.');
-		if (period == NULL)
-		{
-			_cachedExtension = &(_fullPath[ustrlen(_fullPath)]);
-		}
-		else
-		{
-			_cachedExtension = period + 1;
-		}
+		// The scan back from the end stops at the separator before the file name, so only the file name is looked at
+		_cachedExtension = _fullPath + FileDirPath::GetExtensionOffset(_fullPath, _fullPathLength);
 	}
 
 	return _cachedExtension;
@@ -167,20 +231,22 @@ const FILEDIR_CHAR * FileDir::GetExtension()
 
 const FILEDIR_CHAR * FileDir::GetFileNameWithoutExtension()
 {
-	if (!_fileName) return NULL;
+	if (!_fullPath) return NULL;
 
 	if (!_cachedFileNameWithoutExtension)
 	{
-		FILEDIR_CHAR *period = ustrrchr(_fileName, '.');
-		if (period == NULL)
+		const FILEDIR_CHAR *fileName = _fullPath + _fileNameOffset;
+		int fileNameLength = _fullPathLength - _fileNameOffset;
+		int extensionOffset = FileDirPath::GetExtensionOffset(fileName, fileNameLength);
+		if (extensionOffset == fileNameLength)
 		{
-			_cachedFileNameWithoutExtension = ustrdup(_fileName);
+			_cachedFileNameWithoutExtension = ustrdup(fileName);
 		}
 		else
 		{
-			int periodIndex = (int)(period - _fileName);
+			int periodIndex = extensionOffset - 1;
 			FILEDIR_CHAR *fileNameWithoutExtension = (FILEDIR_CHAR *)malloc(sizeof(FILEDIR_CHAR) * (periodIndex + 1));
-			memcpy(fileNameWithoutExtension, _fileName, sizeof(FILEDIR_CHAR) * periodIndex);
+			memcpy(fileNameWithoutExtension, fileName, sizeof(FILEDIR_CHAR) * periodIndex);
 			fileNameWithoutExtension[periodIndex] = '\0';
 			_cachedFileNameWithoutExtension = fileNameWithoutExtension;
 		}
@@ -195,36 +261,10 @@ const FILEDIR_CHAR * FileDir::GetBasePath()
 
 	if (!_cachedBasePath)
 	{
-		FILEDIR_CHAR *separator1 = ustrrchr(_fullPath, '/');
-		FILEDIR_CHAR *separator2 = ustrrchr(_fullPath, '\\');
-		FILEDIR_CHAR *separator = separator1 > separator2 ? separator1 : separator2;
-
-		if (separator[1] == '\0')
-		{
-			if (separator == _fullPath)
-			{
-				separator = NULL;
-			}
-			else
-			{
-				separator1 = ustrrchr(separator - 1, '/');
-				separator2 = ustrrchr(separator - 1, '\\');
-				separator = separator1 > separator2 ? separator1 : separator2;
-			}
-		}
-
-		if (separator == NULL)
-		{
-			_cachedBasePath = (FILEDIR_CHAR *)malloc(sizeof(FILEDIR_CHAR));
-			_cachedBasePath[0] = '\0';
-		}
-		else
-		{
-			int len = (int)(separator - _fullPath + 1);
-			_cachedBasePath = (FILEDIR_CHAR *)malloc(sizeof(FILEDIR_CHAR) * (len + 1));
-			memcpy(_cachedBasePath, _fullPath, sizeof(FILEDIR_CHAR) * len);
-			_cachedBasePath[len] = '\0';
-		}
+		int len = _fileNameOffset;
+		_cachedBasePath = (FILEDIR_CHAR *)malloc(sizeof(FILEDIR_CHAR) * (len + 1));
+		memcpy(_cachedBasePath, _fullPath, sizeof(FILEDIR_CHAR) * len);
+		_cachedBasePath[len] = '\0';
 	}
 
 	return _cachedBasePath;
@@ -37,10 +37,18 @@
 class FileDir
 {
 	friend class FileDirController;
+	friend class FileDirQuery;
+	template <class Policy> friend class BasicFileDirEnumerator;
 public:
 	FileDir(void);
 	virtual ~FileDir(void);
 
+	// A FileDir owns its buffers, so it can be moved but not copied
+	FileDir(FileDir &&other) noexcept;
+	FileDir & operator=(FileDir &&other) noexcept;
+	FileDir(const FileDir &) = delete;
+	FileDir & operator=(const FileDir &) = delete;
+
 	// Returns the full path including drive letter, base path, and file/folder name
 #ifdef _WIN32 /* Wide char */
 	inline const wchar_t * GetFullPath() { return _fullPath; }
@@ -57,9 +65,9 @@ public:
 
 	// Returns the file name including extension, without base path
 #ifdef _WIN32 /* Wide char */
-	inline const wchar_t * GetFileName() { return _fileName; }
+	inline const wchar_t * GetFileName() { return _fullPath ? _fullPath + _fileNameOffset : NULL; }
 #else
-	inline const char * GetFileName() { return _fileName; }
+	inline const char * GetFileName() { return _fullPath ? _fullPath + _fileNameOffset : NULL; }
 #endif
 
 	// Returns the extension without the period
@@ -101,20 +109,47 @@ public:
 	// Get the last status change time
 	time_t GetLastStatusChangeTime();
 
+	// Get the size in bytes, or -1 when unknown
+	inline long long GetSize() { return _size; }
+
 private:
 
+	// Replaces the path and resets everything else, reusing the existing buffer when it is large enough.
+	// The file name starts at fileNameOffset within fullPath.
+#ifdef _WIN32 /* Wide char */
+	void Assign(const wchar_t *fullPath, int fullPathLength, int fileNameOffset);
+#else
+	void Assign(const char *fullPath, int fullPathLength, int fileNameOffset);
+#endif
+
+	// Same as Assign(), with the full path being the folder and the name joined by FileDirPath::Join()
+#ifdef _WIN32 /* Wide char */
+	void AssignJoined(const wchar_t *folder, int folderLength, const wchar_t *name, int nameLength);
+#else
+	void AssignJoined(const char *folder, int folderLength, const char *name, int nameLength);
+#endif
+
+	// Makes room for a full path of the given length, dropping the current one
+	void Reserve(int fullPathLength);
+
+	void ReleaseCache();
+
 #ifdef _WIN32 /* Wide char */
 	wchar_t *_fullPath;
-	wchar_t *_fileName;
 #else /* UTF8 */
 	char *_fullPath;
-	char *_fileName;
 #endif
 
+	int _fullPathCapacity;
+	int _fullPathLength;
+	int _fileNameOffset; // The file name is the end of the full path
+
 	bool _isFolder;
 	bool _isFile;
 	bool _hasTimes;
 
+	long long _size;
+
 	time_t _creationTime;
 	time_t _lastModificationTime;
 	time_t _lastAccessTime;
@@ -0,0 +1,322 @@
+//
+//  FileDirAsyncEnumerator.cpp
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "FileDirAsyncEnumerator.h"
+
+#ifdef FILEDIR_HAS_COROUTINES
+
+#ifndef FILEDIR_CHAR
+
+#ifdef _WIN32
+#define FILEDIR_CHAR wchar_t
+#else
+#define FILEDIR_CHAR char
+#endif
+
+#endif
+
+FileDirIOPool::FileDirIOPool(int threadCount/* = 4*/)
+{
+	_stopping = false;
+
+	if (threadCount < 1) threadCount = 1;
+	for (int i = 0; i < threadCount; i++)
+	{
+		_threads.push_back(std::thread(&FileDirIOPool::WorkerThread, this));
+	}
+}
+
+FileDirIOPool::~FileDirIOPool(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_condition.notify_all();
+
+	for (size_t i = 0; i < _threads.size(); i++)
+	{
+		_threads[i].join();
+	}
+}
+
+FileDirIOPool * FileDirIOPool::Shared()
+{
+	static FileDirIOPool shared;
+	return &shared;
+}
+
+void FileDirIOPool::Post(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push_back(std::move(task));
+	}
+	_condition.notify_one();
+}
+
+void FileDirIOPool::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;)
+	{
+		_condition.wait(lock, [this] { return !_tasks.empty() || _stopping; });
+		if (_tasks.empty()) break;
+
+		std::function<void()> task = std::move(_tasks.front());
+		_tasks.pop_front();
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+typedef std::function<void(std::coroutine_handle<>)> resumer_t;
+
+static void resumeWaiter(const resumer_t &resumer, std::coroutine_handle<> handle)
+{
+	if (resumer)
+	{
+		resumer(handle);
+	}
+	else
+	{
+		handle.resume();
+	}
+}
+
+struct FileDirAsyncEnumerator::State : public std::enable_shared_from_this<FileDirAsyncEnumerator::State>
+{
+	State(FileDirIOPool &ioPool, size_t batchCapacity, size_t maxBuffered)
+		: pool(ioPool), batchSize(batchCapacity), maxBufferedBatches(maxBuffered),
+		recursive(false), generation(0), startedGeneration(0), producing(false), finished(true), cancelled(false) { }
+
+	FileDirIOPool &pool;
+	FileDirController controller; // Only used by Produce(), of which one runs at a time
+	size_t batchSize;
+	size_t maxBufferedBatches;
+
+	std::mutex mutex;
+	std::basic_string<FILEDIR_CHAR> path;
+	bool recursive;
+	resumer_t resumer;
+	std::deque<Batch> batches;
+	std::coroutine_handle<> waiter;
+	unsigned int generation; // Bumped by Start(), so a Produce() of an earlier enumeration throws its batch away
+	unsigned int startedGeneration; // The enumeration the controller was started for
+	bool producing;
+	bool finished;
+	std::atomic<bool> cancelled;
+
+	void ScheduleProduceLocked()
+	{
+		if (producing || finished || cancelled || batches.size() >= maxBufferedBatches) return;
+
+		producing = true;
+		std::shared_ptr<State> self = shared_from_this();
+		pool.Post([self] { self->Produce(); });
+	}
+
+	// Runs on the pool
+	void Produce()
+	{
+		unsigned int producingGeneration;
+		std::basic_string<FILEDIR_CHAR> startPath;
+		bool start, startRecursive = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			producingGeneration = generation;
+			start = startedGeneration != generation;
+			if (start)
+			{
+				startedGeneration = generation;
+				startPath = path;
+				startRecursive = recursive;
+			}
+		}
+
+		bool done = false;
+		if (start && !controller.EnumerateFilesAtPath(startPath.c_str(), startRecursive))
+		{
+			done = true;
+		}
+
+		Batch batch;
+		batch.reserve(batchSize);
+		while (!done && !cancelled && batch.size() < batchSize)
+		{
+			if (!controller.HasNext())
+			{
+				done = true;
+				break;
+			}
+
+			FileDir *fileDir = controller.NextFile();
+			if (fileDir)
+			{
+				batch.push_back(std::unique_ptr<FileDir>(fileDir));
+			}
+		}
+
+		// Everything is taken while locked, so nothing of the state is touched after producing is cleared
+		std::coroutine_handle<> resumedWaiter;
+		resumer_t resumedWith;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (producingGeneration == generation)
+			{
+				if (!cancelled && !batch.empty())
+				{
+					batches.push_back(std::move(batch));
+				}
+				if (done)
+				{
+					finished = true;
+					controller.Close();
+				}
+			}
+
+			if (waiter && (!batches.empty() || finished || cancelled))
+			{
+				resumedWaiter = waiter;
+				waiter = nullptr;
+				resumedWith = resumer;
+			}
+
+			producing = false;
+			ScheduleProduceLocked();
+		}
+
+		if (resumedWaiter)
+		{
+			resumeWaiter(resumedWith, resumedWaiter);
+		}
+	}
+};
+
+FileDirAsyncEnumerator::FileDirAsyncEnumerator(FileDirIOPool &pool, size_t batchSize/* = 256*/, size_t maxBufferedBatches/* = 4*/)
+{
+	_state = std::make_shared<State>(pool, batchSize ? batchSize : 1, maxBufferedBatches ? maxBufferedBatches : 1);
+}
+
+FileDirAsyncEnumerator::~FileDirAsyncEnumerator(void)
+{
+	// Never waits for the pool: this may well run on one of its threads, inside a resumed coroutine
+	Cancel();
+}
+
+FileDirController & FileDirAsyncEnumerator::GetController()
+{
+	return _state->controller;
+}
+
+void FileDirAsyncEnumerator::SetResumer(std::function<void(std::coroutine_handle<>)> resumer)
+{
+	std::lock_guard<std::mutex> lock(_state->mutex);
+	_state->resumer = resumer;
+}
+
+void FileDirAsyncEnumerator::Start(const FILEDIR_CHAR *path, bool recursive/* = false*/)
+{
+	std::lock_guard<std::mutex> lock(_state->mutex);
+
+	if (path)
+	{
+		_state->path = path;
+	}
+	else
+	{
+		_state->path.clear();
+	}
+	_state->recursive = recursive;
+	_state->generation++;
+	_state->finished = false;
+	_state->cancelled = false;
+	_state->batches.clear();
+
+	// If a Produce() of a previous enumeration is still running, it schedules this one when it is done
+	_state->ScheduleProduceLocked();
+}
+
+void FileDirAsyncEnumerator::Cancel()
+{
+	std::coroutine_handle<> waiter;
+	resumer_t resumer;
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		_state->cancelled = true;
+		_state->batches.clear();
+		waiter = _state->waiter;
+		_state->waiter = nullptr;
+		resumer = _state->resumer;
+	}
+
+	if (waiter)
+	{
+		resumeWaiter(resumer, waiter);
+	}
+}
+
+bool FileDirAsyncEnumerator::Suspend(std::coroutine_handle<> handle)
+{
+	std::lock_guard<std::mutex> lock(_state->mutex);
+
+	if (!_state->batches.empty() || _state->finished || _state->cancelled)
+	{
+		return false; // Resume right away
+	}
+
+	_state->waiter = handle;
+	_state->ScheduleProduceLocked();
+	return true;
+}
+
+FileDirAsyncEnumerator::Batch FileDirAsyncEnumerator::TakeBatch()
+{
+	std::lock_guard<std::mutex> lock(_state->mutex);
+
+	Batch batch;
+	if (!_state->batches.empty())
+	{
+		batch = std::move(_state->batches.front());
+		_state->batches.pop_front();
+	}
+
+	// There is room in the buffer again
+	_state->ScheduleProduceLocked();
+
+	return batch;
+}
+
+#endif
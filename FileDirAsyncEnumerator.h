@@ -0,0 +1,147 @@
+//
+//  FileDirAsyncEnumerator.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#pragma once
+
+#include "FileDir.h"
+#include "FileDirController.h"
+
+#if defined(__has_include)
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define FILEDIR_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef FILEDIR_HAS_COROUTINES
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A pool of threads for blocking folder I/O, shared by any number of FileDirAsyncEnumerators
+class FileDirIOPool
+{
+public:
+	FileDirIOPool(int threadCount = 4);
+	virtual ~FileDirIOPool(void); // Runs the tasks already queued, then stops
+
+	// A process wide pool
+	static FileDirIOPool * Shared();
+
+	void Post(std::function<void()> task);
+
+private:
+	void WorkerThread();
+
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::deque<std::function<void()>> _tasks;
+	std::vector<std::thread> _threads;
+	bool _stopping;
+};
+
+// Enumerates on a FileDirIOPool, handing out batches of entries to a coroutine:
+//
+//	FileDirAsyncEnumerator enumerator(*FileDirIOPool::Shared());
+//	enumerator.Start("/some/path", true);
+//	for (;;)
+//	{
+//		FileDirAsyncEnumerator::Batch batch = co_await enumerator.NextBatch();
+//		if (batch.empty()) break; // Done or cancelled
+//		...
+//	}
+//
+// At most maxBufferedBatches batches are read ahead. When the consumer falls behind, the walk pauses until it catches up.
+// The awaiting coroutine is resumed on the I/O thread which produced the batch, unless a resumer is set.
+// Neither the destructor nor Start() wait for the pool, so both are safe to call from the resumed coroutine on an I/O thread.
+class FileDirAsyncEnumerator
+{
+public:
+	typedef std::vector<std::unique_ptr<FileDir>> Batch;
+
+	class BatchAwaiter
+	{
+	public:
+		explicit BatchAwaiter(FileDirAsyncEnumerator &enumerator) : _enumerator(enumerator) {}
+
+		inline bool await_ready() { return false; }
+		inline bool await_suspend(std::coroutine_handle<> handle) { return _enumerator.Suspend(handle); }
+		inline Batch await_resume() { return _enumerator.TakeBatch(); }
+
+	private:
+		FileDirAsyncEnumerator &_enumerator;
+	};
+
+	FileDirAsyncEnumerator(FileDirIOPool &pool, size_t batchSize = 256, size_t maxBufferedBatches = 4);
+	virtual ~FileDirAsyncEnumerator(void); // Cancels. A batch in flight finishes on the pool by itself.
+
+	// The controller used on the I/O threads. Configure it (error handler, cache) before Start().
+	// Its error handler is called on the I/O threads, and after Cancel() or destruction it may still be called
+	// until the batch in flight notices, within one NextFile(). Its context must outlive that.
+	FileDirController & GetController();
+
+	// Sets how to resume the awaiting coroutine, i.e. by posting it to an event loop. Set before Start().
+	void SetResumer(std::function<void(std::coroutine_handle<>)> resumer);
+
+	// Starts enumerating in the background. Returns immediately, also when restarting after Cancel().
+#ifdef _WIN32 /* Wide char */
+	void Start(const wchar_t *path, bool recursive = false);
+#else /* UTF8 */
+	void Start(const char *path, bool recursive = false);
+#endif
+
+	// co_await for the next batch of entries. An empty batch means the enumeration is done or was cancelled.
+	inline BatchAwaiter NextBatch() { return BatchAwaiter(*this); }
+
+	// Stops the enumeration. A pending NextBatch() resumes with an empty batch.
+	void Cancel();
+
+private:
+	friend class BatchAwaiter;
+
+	// Everything the I/O threads use. The tasks posted to the pool share it, so it outlives the enumerator if they run late.
+	struct State;
+
+	bool Suspend(std::coroutine_handle<> handle);
+	Batch TakeBatch();
+
+	std::shared_ptr<State> _state;
+};
+
+#endif
@@ -0,0 +1,453 @@
+//
+//  FileDirCache.cpp
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "FileDirCache.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef FILEDIR_CHAR
+
+#ifdef _WIN32
+#define FILEDIR_CHAR wchar_t
+#define ustrlen wcslen
+#define ustrcmp wcscmp
+#else
+#define FILEDIR_CHAR char
+#define ustrlen strlen
+#define ustrcmp strcmp
+#endif
+
+#endif
+
+#ifdef __APPLE__
+#define STAT_MTIME_NSEC(st) ((int64_t)(st).st_mtimespec.tv_sec * 1000000000LL + (st).st_mtimespec.tv_nsec)
+#define STAT_CTIME_NSEC(st) ((int64_t)(st).st_ctimespec.tv_sec * 1000000000LL + (st).st_ctimespec.tv_nsec)
+#elif !defined(_WIN32)
+#define STAT_MTIME_NSEC(st) ((int64_t)(st).st_mtim.tv_sec * 1000000000LL + (st).st_mtim.tv_nsec)
+#define STAT_CTIME_NSEC(st) ((int64_t)(st).st_ctim.tv_sec * 1000000000LL + (st).st_ctim.tv_nsec)
+#endif
+
+#ifdef _WIN32
+#define FILETIME_TO_INT64(FILETIME) ((int64_t)(((__int64)FILETIME.dwLowDateTime) | (((__int64)FILETIME.dwHighDateTime) << 32)))
+#define FILETIME_TO_TIME_T(FILETIME) ((time_t)((FILETIME_TO_INT64(FILETIME) - 116444736000000000LL) / 10000000LL))
+#endif
+
+// Folders modified more recently than this are not cached, as another change within the same timestamp tick would go unnoticed
+#define RACY_INTERVAL_NS (2 * 1000000000LL)
+
+#define IS_DOTS(name) (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+
+// Reads the identity and version of a folder
+static bool readFolderKey(const FILEDIR_CHAR *path, FileDirCacheKey &key, int &errorCode)
+{
+#ifdef _WIN32
+	HANDLE handle = CreateFileW(path, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		errorCode = (int)GetLastError();
+		return false;
+	}
+
+	BY_HANDLE_FILE_INFORMATION info;
+	BOOL succeeded = GetFileInformationByHandle(handle, &info);
+	if (!succeeded)
+	{
+		errorCode = (int)GetLastError();
+	}
+	CloseHandle(handle);
+	if (!succeeded) return false;
+
+	if (!(info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+	{
+		errorCode = ERROR_DIRECTORY;
+		return false;
+	}
+
+	key.device = info.dwVolumeSerialNumber;
+	key.inode = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+	key.modificationTime = (FILETIME_TO_INT64(info.ftLastWriteTime) - 116444736000000000LL) * 100;
+	key.statusChangeTime = 0;
+#else
+	struct stat folderStat;
+	if (stat(path, &folderStat) == -1)
+	{
+		errorCode = errno;
+		return false;
+	}
+
+	if (!S_ISDIR(folderStat.st_mode))
+	{
+		errorCode = ENOTDIR;
+		return false;
+	}
+
+	key.device = (uint64_t)folderStat.st_dev;
+	key.inode = (uint64_t)folderStat.st_ino;
+	key.modificationTime = STAT_MTIME_NSEC(folderStat);
+	key.statusChangeTime = STAT_CTIME_NSEC(folderStat);
+#endif
+
+	return true;
+}
+
+static int64_t nowNs()
+{
+#ifdef _WIN32
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	return (FILETIME_TO_INT64(now) - 116444736000000000LL) * 100;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+struct EntryNameLess
+{
+	const FILEDIR_CHAR *names;
+
+	inline bool operator()(const FileDirCacheEntry &a, const FileDirCacheEntry &b) const
+	{
+		return ustrcmp(names + a.nameOffset, names + b.nameOffset) < 0;
+	}
+};
+
+static void appendEntry(FileDirCacheListing *listing, const FILEDIR_CHAR *name, FileDirCacheEntry &entry)
+{
+	size_t nameLength = ustrlen(name);
+	entry.nameOffset = (uint32_t)listing->names.size();
+	entry.nameLength = (uint32_t)nameLength;
+	listing->names.insert(listing->names.end(), name, name + nameLength + 1);
+	listing->entries.push_back(entry);
+}
+
+// Reads a whole folder, including the metadata of each entry
+static FileDirCacheListing *readListing(const FILEDIR_CHAR *path, int &errorCode)
+{
+	FileDirCacheListing *listing = new FileDirCacheListing();
+
+#ifdef _WIN32
+	size_t pathLength = ustrlen(path);
+	std::vector<wchar_t> pattern(path, path + pathLength);
+	if (pathLength && path[pathLength - 1] != '\\' && path[pathLength - 1] != '/')
+	{
+		pattern.push_back('\\');
+	}
+	pattern.push_back('*');
+	pattern.push_back('\0');
+
+	WIN32_FIND_DATAW data;
+	HANDLE handle = FindFirstFileW(&pattern[0], &data);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		errorCode = (int)GetLastError();
+		delete listing;
+		return NULL;
+	}
+
+	do
+	{
+		if (IS_DOTS(data.cFileName)) continue;
+
+		FileDirCacheEntry entry;
+		entry.errorCode = 0;
+		entry.isFolder = !!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+		entry.isFile = !entry.isFolder && !(data.dwFileAttributes & FILE_ATTRIBUTE_DEVICE);
+		entry.creationTime = FILETIME_TO_TIME_T(data.ftCreationTime);
+		entry.lastModificationTime = FILETIME_TO_TIME_T(data.ftLastWriteTime);
+		entry.lastAccessTime = FILETIME_TO_TIME_T(data.ftLastAccessTime);
+		entry.lastStatusChangeTime = -1;
+		entry.size = ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+		appendEntry(listing, data.cFileName, entry);
+	}
+	while (FindNextFileW(handle, &data));
+
+	DWORD error = GetLastError();
+	FindClose(handle);
+
+	if (error != ERROR_NO_MORE_FILES)
+	{
+		errorCode = (int)error;
+		delete listing;
+		return NULL;
+	}
+#else
+	DIR *dir = opendir(path);
+	if (!dir)
+	{
+		errorCode = errno;
+		delete listing;
+		return NULL;
+	}
+
+	for (;;)
+	{
+		errno = 0;
+		dirent *dirEntry = readdir(dir);
+		if (!dirEntry)
+		{
+			if (errno)
+			{
+				errorCode = errno;
+				closedir(dir);
+				delete listing;
+				return NULL;
+			}
+			break;
+		}
+
+		if (IS_DOTS(dirEntry->d_name)) continue;
+
+		FileDirCacheEntry entry;
+		memset(&entry, 0, sizeof(entry));
+
+		struct stat fileStat;
+		if (fstatat(dirfd(dir), dirEntry->d_name, &fileStat, 0) == -1)
+		{
+			entry.errorCode = errno;
+		}
+		else
+		{
+			entry.isFile = S_ISREG(fileStat.st_mode);
+			entry.isFolder = S_ISDIR(fileStat.st_mode);
+			entry.creationTime = -1;
+			entry.lastModificationTime = fileStat.st_mtime;
+			entry.lastAccessTime = fileStat.st_atime;
+			entry.lastStatusChangeTime = fileStat.st_ctime;
+			entry.size = (long long)fileStat.st_size;
+		}
+		appendEntry(listing, dirEntry->d_name, entry);
+	}
+
+	closedir(dir);
+#endif
+
+	EntryNameLess less;
+	less.names = listing->names.empty() ? NULL : &listing->names[0];
+	std::sort(listing->entries.begin(), listing->entries.end(), less);
+
+	listing->entries.shrink_to_fit();
+	listing->names.shrink_to_fit();
+
+	return listing;
+}
+
+const FileDirCacheEntry * FileDirCacheListing::Find(const FILEDIR_CHAR *name) const
+{
+	size_t low = 0, high = entries.size();
+	while (low < high)
+	{
+		size_t middle = (low + high) / 2;
+		int compare = ustrcmp(GetName(entries[middle]), name);
+		if (compare == 0) return &entries[middle];
+		if (compare < 0)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return NULL;
+}
+
+size_t FileDirCacheListing::GetByteSize() const
+{
+	return sizeof(FileDirCacheListing) +
+		entries.capacity() * sizeof(FileDirCacheEntry) +
+		names.capacity() * sizeof(FILEDIR_CHAR);
+}
+
+FileDirCache::FileDirCache(size_t byteBudget/* = 64 * 1024 * 1024*/)
+{
+	_byteBudget = byteBudget;
+	_byteSize = 0;
+}
+
+FileDirCache::~FileDirCache(void)
+{
+	Clear();
+}
+
+FileDirCache * FileDirCache::Shared()
+{
+	static FileDirCache shared;
+	return &shared;
+}
+
+FileDirCacheListingRef FileDirCache::Lookup(const FileDirCacheKey &key)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::unordered_map<std::pair<uint64_t, uint64_t>, Node, KeyHash>::iterator it = _listings.find(std::make_pair(key.device, key.inode));
+	if (it == _listings.end())
+	{
+		return FileDirCacheListingRef();
+	}
+
+	if (!it->second.listing->key.IsSameVersion(key))
+	{
+		_byteSize -= it->second.listing->GetByteSize();
+		_lru.erase(it->second.lruPosition);
+		_listings.erase(it);
+		return FileDirCacheListingRef();
+	}
+
+	_lru.splice(_lru.begin(), _lru, it->second.lruPosition);
+	return it->second.listing;
+}
+
+void FileDirCache::Insert(const FileDirCacheListingRef &listing)
+{
+	size_t byteSize = listing->GetByteSize();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (byteSize > _byteBudget) return;
+
+	std::pair<uint64_t, uint64_t> key = std::make_pair(listing->key.device, listing->key.inode);
+	std::unordered_map<std::pair<uint64_t, uint64_t>, Node, KeyHash>::iterator it = _listings.find(key);
+	if (it != _listings.end())
+	{
+		_byteSize -= it->second.listing->GetByteSize();
+		it->second.listing = listing;
+		_lru.splice(_lru.begin(), _lru, it->second.lruPosition);
+	}
+	else
+	{
+		_lru.push_front(key);
+		Node &node = _listings[key];
+		node.listing = listing;
+		node.lruPosition = _lru.begin();
+	}
+	_byteSize += byteSize;
+
+	EvictToBudget();
+}
+
+void FileDirCache::EvictToBudget()
+{
+	while (_byteSize > _byteBudget && !_lru.empty())
+	{
+		std::unordered_map<std::pair<uint64_t, uint64_t>, Node, KeyHash>::iterator it = _listings.find(_lru.back());
+		_byteSize -= it->second.listing->GetByteSize();
+		_listings.erase(it);
+		_lru.pop_back();
+	}
+}
+
+FileDirCacheListingRef FileDirCache::GetListing(const FILEDIR_CHAR *path, int *errorCode/* = NULL*/)
+{
+	int error = 0;
+	FileDirCacheKey key;
+	if (!path || !readFolderKey(path, key, error))
+	{
+		if (errorCode) *errorCode = error;
+		return FileDirCacheListingRef();
+	}
+
+	FileDirCacheListingRef cached = Lookup(key);
+	if (cached)
+	{
+		return cached;
+	}
+
+	FileDirCacheListing *listing = readListing(path, error);
+	if (!listing)
+	{
+		if (errorCode) *errorCode = error;
+		return FileDirCacheListingRef();
+	}
+	listing->key = key;
+
+	FileDirCacheListingRef ref(listing);
+
+	// Only cache if the folder did not change while it was read, and is not too fresh to trust its timestamps
+	FileDirCacheKey keyAfter;
+	if (readFolderKey(path, keyAfter, error) && keyAfter.IsSameVersion(key) &&
+		nowNs() - key.modificationTime >= RACY_INTERVAL_NS &&
+		nowNs() - key.statusChangeTime >= RACY_INTERVAL_NS)
+	{
+		Insert(ref);
+	}
+
+	return ref;
+}
+
+FileDirCacheListingRef FileDirCache::FindListing(const FILEDIR_CHAR *path)
+{
+	int error = 0;
+	FileDirCacheKey key;
+	if (!path || !readFolderKey(path, key, error))
+	{
+		return FileDirCacheListingRef();
+	}
+
+	return Lookup(key);
+}
+
+void FileDirCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_listings.clear();
+	_lru.clear();
+	_byteSize = 0;
+}
+
+void FileDirCache::SetByteBudget(size_t byteBudget)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_byteBudget = byteBudget;
+	EvictToBudget();
+}
+
+size_t FileDirCache::GetByteSize()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _byteSize;
+}
@@ -0,0 +1,171 @@
+//
+//  FileDirCache.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One entry of a cached folder listing
+struct FileDirCacheEntry
+{
+	uint32_t nameOffset; // Into FileDirCacheListing::names, null terminated
+	uint32_t nameLength;
+	int errorCode; // Non zero if the entry's metadata could not be read
+	bool isFile;
+	bool isFolder;
+	time_t creationTime;
+	time_t lastModificationTime;
+	time_t lastAccessTime;
+	time_t lastStatusChangeTime;
+	long long size;
+};
+
+// The identity and version of a folder. A listing is valid as long as all of these are unchanged.
+struct FileDirCacheKey
+{
+	uint64_t device;
+	uint64_t inode;
+	int64_t modificationTime; // In nanoseconds
+	int64_t statusChangeTime; // In nanoseconds
+
+	inline bool IsSameFolder(const FileDirCacheKey &other) const { return device == other.device && inode == other.inode; }
+	inline bool IsSameVersion(const FileDirCacheKey &other) const { return IsSameFolder(other) && modificationTime == other.modificationTime && statusChangeTime == other.statusChangeTime; }
+};
+
+// An immutable listing of a single folder, sorted by name
+class FileDirCacheListing
+{
+public:
+	FileDirCacheKey key;
+	std::vector<FileDirCacheEntry> entries;
+#ifdef _WIN32 /* Wide char */
+	std::vector<wchar_t> names;
+#else /* UTF8 */
+	std::vector<char> names;
+#endif
+
+	// Returns the entry's name
+#ifdef _WIN32 /* Wide char */
+	inline const wchar_t * GetName(const FileDirCacheEntry &entry) const { return &names[entry.nameOffset]; }
+#else
+	inline const char * GetName(const FileDirCacheEntry &entry) const { return &names[entry.nameOffset]; }
+#endif
+
+	// Finds an entry by its exact name, or returns NULL
+#ifdef _WIN32 /* Wide char */
+	const FileDirCacheEntry * Find(const wchar_t *name) const;
+#else
+	const FileDirCacheEntry * Find(const char *name) const;
+#endif
+
+	// Approximate memory used by the listing
+	size_t GetByteSize() const;
+};
+
+typedef std::shared_ptr<const FileDirCacheListing> FileDirCacheListingRef;
+
+// A cache of folder listings, including each entry's metadata.
+// A cached listing is validated with a single stat() of the folder, comparing its device, inode, modification time and
+// status change time. So a folder whose entries were not added, removed or renamed is served from the cache, and
+// changes to the contents of files in it (i.e. their modification times) are not noticed until the folder changes.
+// Listings of folders modified in the last couple of seconds are not cached, as further changes within the same
+// timestamp tick would go unnoticed.
+// All methods are thread safe. Listings are shared, and stay valid while referenced even if evicted.
+class FileDirCache
+{
+public:
+	FileDirCache(size_t byteBudget = 64 * 1024 * 1024);
+	virtual ~FileDirCache(void);
+
+	// A process wide cache
+	static FileDirCache * Shared();
+
+	// Returns the listing of a folder, from the cache if it is still valid, or reads it and caches it.
+	// Returns NULL if the folder could not be read, and sets errorCode.
+#ifdef _WIN32 /* Wide char */
+	FileDirCacheListingRef GetListing(const wchar_t *path, int *errorCode = NULL);
+#else /* UTF8 */
+	FileDirCacheListingRef GetListing(const char *path, int *errorCode = NULL);
+#endif
+
+	// Returns the listing of a folder only if it is cached and still valid. Never reads the folder.
+#ifdef _WIN32 /* Wide char */
+	FileDirCacheListingRef FindListing(const wchar_t *path);
+#else /* UTF8 */
+	FileDirCacheListingRef FindListing(const char *path);
+#endif
+
+	// Drops all cached listings
+	void Clear();
+
+	// Sets the maximum memory for listings, evicting the least recently used ones as needed
+	void SetByteBudget(size_t byteBudget);
+
+	inline size_t GetByteBudget() { return _byteBudget; }
+
+	// Memory currently used by cached listings
+	size_t GetByteSize();
+
+private:
+	struct KeyHash
+	{
+		inline size_t operator()(const std::pair<uint64_t, uint64_t> &key) const
+		{
+			return (size_t)(key.first * 0x9E3779B97F4A7C15ULL ^ key.second);
+		}
+	};
+
+	struct Node
+	{
+		FileDirCacheListingRef listing;
+		std::list<std::pair<uint64_t, uint64_t> >::iterator lruPosition;
+	};
+
+	FileDirCacheListingRef Lookup(const FileDirCacheKey &key);
+	void Insert(const FileDirCacheListingRef &listing);
+	void EvictToBudget();
+
+	std::mutex _mutex;
+	size_t _byteBudget;
+	size_t _byteSize;
+
+	// Keyed by (device, inode). Most recently used at the front of the list.
+	std::unordered_map<std::pair<uint64_t, uint64_t>, Node, KeyHash> _listings;
+	std::list<std::pair<uint64_t, uint64_t> > _lru;
+};
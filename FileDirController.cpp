@@ -32,10 +32,19 @@
 
 #include "FileDirController.h"
 #include "FileDir.h"
+#include "FileDirCache.h"
+#include "FileDirPath.h"
 
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -43,8 +52,10 @@
 #pragma warning (disable : 4996)
 #else
 #include <dirent.h>
+#include <fcntl.h>
 #include <libgen.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #ifdef _WIN32
@@ -101,6 +112,244 @@
 
 #endif
 
+#define IS_DOTS(name) (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+
+#ifndef _WIN32
+
+// A folder which is read ahead by a FileDirPrefetcher
+typedef struct _prefetch_folder_t {
+	DIR *dir;
+	std::deque<FileDirCacheListing *> ready; // Batches read ahead, oldest first
+	FileDirCacheListing *current; // The batch being consumed
+	bool busy; // The worker is reading into it right now
+	bool eof;
+	int readError;
+} prefetch_folder_t;
+
+// Reads folders ahead on a background thread, in batches of entries including their metadata.
+// The batches use the same format as FileDirCache's listings, and are recycled.
+// Only the folder being consumed is read ahead, by up to depth batches.
+class FileDirPrefetcher
+{
+public:
+	FileDirPrefetcher(int depth, int batchSize, FileDirStats &stats)
+		: _stats(stats)
+	{
+		_depth = depth;
+		_batchSize = batchSize;
+		_target = NULL;
+		_stopping = false;
+		_thread = std::thread(&FileDirPrefetcher::WorkerThread, this);
+	}
+
+	~FileDirPrefetcher()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_condition.notify_all();
+		_thread.join();
+
+		for (size_t i = 0; i < _freeBatches.size(); i++)
+		{
+			delete _freeBatches[i];
+		}
+	}
+
+	// Starts reading ahead an open folder
+	prefetch_folder_t * Open(DIR *dir)
+	{
+		prefetch_folder_t *folder = new prefetch_folder_t();
+		folder->dir = dir;
+		folder->current = NULL;
+		folder->busy = false;
+		folder->eof = false;
+		folder->readError = 0;
+
+		SetTarget(folder);
+
+		return folder;
+	}
+
+	// Makes a folder the one being read ahead
+	void SetTarget(prefetch_folder_t *folder)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_target = folder;
+		}
+		_condition.notify_all();
+	}
+
+	// Recycles the folder's current batch and returns the next one, waiting for it if needed.
+	// Returns NULL at the end of the folder, and sets readError if reading failed.
+	const FileDirCacheListing * TakeBatch(prefetch_folder_t *folder, int &readError)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		if (folder->current)
+		{
+			_freeBatches.push_back(folder->current);
+			folder->current = NULL;
+		}
+
+		_target = folder;
+		_condition.notify_all();
+		_condition.wait(lock, [folder] { return !folder->ready.empty() || folder->eof; });
+
+		if (folder->ready.empty())
+		{
+			readError = folder->readError;
+			return NULL;
+		}
+
+		folder->current = folder->ready.front();
+		folder->ready.pop_front();
+		_condition.notify_all(); // There is room to read ahead again
+
+		return folder->current;
+	}
+
+	// Stops reading ahead, and closes the folder
+	void Release(prefetch_folder_t *folder)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [folder] { return !folder->busy; });
+
+			if (_target == folder)
+			{
+				_target = NULL;
+			}
+
+			if (folder->current)
+			{
+				_freeBatches.push_back(folder->current);
+			}
+			_freeBatches.insert(_freeBatches.end(), folder->ready.begin(), folder->ready.end());
+		}
+
+		closedir(folder->dir);
+		delete folder;
+	}
+
+private:
+
+	void WorkerThread()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		for (;;)
+		{
+			_condition.wait(lock, [this] { return _stopping || (_target && !_target->eof && (int)_target->ready.size() < _depth); });
+			if (_stopping) break;
+
+			prefetch_folder_t *folder = _target;
+			folder->busy = true;
+
+			FileDirCacheListing *batch;
+			if (_freeBatches.empty())
+			{
+				batch = new FileDirCacheListing();
+				_stats.Allocated(sizeof(FileDirCacheListing));
+			}
+			else
+			{
+				batch = _freeBatches.back();
+				_freeBatches.pop_back();
+			}
+
+			lock.unlock();
+			int readError = 0;
+			bool eof = !Fill(folder->dir, batch, readError);
+			lock.lock();
+
+			if (batch->entries.empty())
+			{
+				_freeBatches.push_back(batch);
+			}
+			else
+			{
+				folder->ready.push_back(batch);
+			}
+
+			if (eof)
+			{
+				folder->eof = true;
+				folder->readError = readError;
+			}
+
+			folder->busy = false;
+			_condition.notify_all();
+		}
+	}
+
+	// Reads up to a batch of entries. Returns false at the end of the folder.
+	bool Fill(DIR *dir, FileDirCacheListing *batch, int &readError)
+	{
+		batch->entries.clear();
+		batch->names.clear();
+
+		while ((int)batch->entries.size() < _batchSize)
+		{
+			uint64_t readBegin = _stats.BeginPhase();
+			errno = 0;
+			dirent *dirEntry = readdir(dir);
+			_stats.EndPhase(FileDirStatsPhaseRead, readBegin);
+
+			if (!dirEntry)
+			{
+				readError = errno;
+				return false;
+			}
+
+			if (IS_DOTS(dirEntry->d_name)) continue;
+
+			FileDirCacheEntry entry;
+			memset(&entry, 0, sizeof(entry));
+
+			uint64_t statBegin = _stats.BeginPhase();
+			struct stat fileStat;
+			bool statSucceeded = fstatat(dirfd(dir), dirEntry->d_name, &fileStat, 0) != -1;
+			entry.errorCode = statSucceeded ? 0 : errno;
+			_stats.EndPhase(FileDirStatsPhaseStat, statBegin);
+			_stats.StatIssued(statSucceeded);
+
+			if (statSucceeded)
+			{
+				entry.isFile = IS_REGULAR_FILE(fileStat.st_mode);
+				entry.isFolder = IS_FOLDER(fileStat.st_mode);
+				entry.creationTime = -1;
+				entry.lastModificationTime = fileStat.st_mtime;
+				entry.lastAccessTime = fileStat.st_atime;
+				entry.lastStatusChangeTime = fileStat.st_ctime;
+				entry.size = (long long)fileStat.st_size;
+			}
+
+			size_t nameLength = strlen(dirEntry->d_name);
+			entry.nameOffset = (uint32_t)batch->names.size();
+			entry.nameLength = (uint32_t)nameLength;
+			batch->names.insert(batch->names.end(), dirEntry->d_name, dirEntry->d_name + nameLength + 1);
+			batch->entries.push_back(entry);
+		}
+
+		return true;
+	}
+
+	int _depth;
+	int _batchSize;
+	FileDirStats &_stats;
+
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	prefetch_folder_t *_target;
+	std::vector<FileDirCacheListing *> _freeBatches;
+	bool _stopping;
+};
+
+#endif
+
 #ifdef _WIN32
 typedef struct _find_data_t {
 	_find_data_t()
@@ -108,14 +357,18 @@ typedef struct _find_data_t {
 		handle = INVALID_HANDLE_VALUE;
 		memset(&data, 0, sizeof(data));
 		hasNext = false;
+		readError = 0;
 		basePath = NULL;
 		basePathLength = 0;
+		listed = NULL;
+		listedIndex = 0;
 	}
-	void release()
+	void release(FileDirStats &stats)
 	{
 		if (handle != INVALID_HANDLE_VALUE)
 		{
 			FindClose(handle);
+			stats.DirectoryClosed();
 		}
 		if (basePath)
 		{
@@ -126,8 +379,12 @@ typedef struct _find_data_t {
 	HANDLE handle;
 	WIN32_FIND_DATAW data;
 	bool hasNext;
+	int readError;
 	wchar_t *basePath;
 	int basePathLength;
+	FileDirCacheListingRef listing; // Set when the folder is listed through a FileDirCache
+	const FileDirCacheListing *listed; // The entries being iterated, when listed through a FileDirCache
+	size_t listedIndex;
 } find_data_t;
 #else
 typedef struct _find_data_t {
@@ -136,14 +393,25 @@ typedef struct _find_data_t {
 		dir = NULL;
 		entry = NULL;
 		hasNext = false;
+		readError = 0;
 		basePath = NULL;
 		basePathLength = 0;
+		listed = NULL;
+		listedIndex = 0;
+		prefetch = NULL;
+		prefetcher = NULL;
 	}
-	void release()
+	void release(FileDirStats &stats)
 	{
 		if (dir)
 		{
 			closedir(dir);
+			stats.DirectoryClosed();
+		}
+		if (prefetch)
+		{
+			prefetcher->Release(prefetch);
+			stats.DirectoryClosed();
 		}
 		if (basePath)
 		{
@@ -154,16 +422,89 @@ typedef struct _find_data_t {
 	DIR *dir;
 	dirent *entry;
 	bool hasNext;
+	int readError;
 	char *basePath;
 	int basePathLength;
+	FileDirCacheListingRef listing; // Set when the folder is listed through a FileDirCache
+	const FileDirCacheListing *listed; // The entries being iterated, when listed through a FileDirCache or prefetched
+	size_t listedIndex;
+	prefetch_folder_t *prefetch; // Set when the folder is read ahead by a FileDirPrefetcher
+	FileDirPrefetcher *prefetcher;
 } find_data_t;
 #endif
 
-static find_data_t *openFolderForSearch(const FILEDIR_CHAR *path)
+// Moves to the next entry, skipping "." and "..".
+// Returns false at the end of the folder, or when reading failed (readError is set).
+static bool readNextEntry(find_data_t *data, FileDirStats &stats)
+{
+	if (data->listed)
+	{
+		data->listedIndex++;
+#ifndef _WIN32
+		if (data->prefetch && data->listedIndex >= data->listed->entries.size())
+		{
+			data->listed = data->prefetcher->TakeBatch(data->prefetch, data->readError);
+			data->listedIndex = 0;
+			data->hasNext = data->listed != NULL;
+			return data->hasNext;
+		}
+#endif
+		data->hasNext = data->listedIndex < data->listed->entries.size();
+		return data->hasNext;
+	}
+
+	uint64_t begin = stats.BeginPhase();
+
+#ifdef _WIN32
+
+	do
+	{
+		if (FindNextFileW(data->handle, &data->data) == 0)
+		{
+			DWORD error = GetLastError();
+			data->readError = error == ERROR_NO_MORE_FILES ? 0 : (int)error;
+			data->hasNext = false;
+			break;
+		}
+		data->hasNext = true;
+	}
+	while (IS_DOTS(data->data.cFileName));
+
+#else
+
+	do
+	{
+		errno = 0;
+		data->entry = readdir(data->dir);
+		if (data->entry == NULL)
+		{
+			data->readError = errno;
+			break;
+		}
+	}
+	while (IS_DOTS(data->entry->d_name));
+
+	data->hasNext = data->entry != NULL;
+
+#endif
+
+	stats.EndPhase(FileDirStatsPhaseRead, begin);
+
+	return data->hasNext;
+}
+
+// Opens a folder and reads its first entry. If a cache is given, the listing is taken from it instead,
+// and if a prefetcher is given, the folder is handed to it.
+// Returns NULL if the folder could not be opened (errorCode is set).
+// Check readError for failures while reading the first entry.
+static find_data_t *openFolderForSearch(const FILEDIR_CHAR *path, FileDirStats &stats, int &errorCode, FileDirCache *cache, FileDirPrefetcher *prefetcher)
 {
+	uint64_t begin = stats.BeginPhase();
+
 	find_data_t *data = new find_data_t();
 
 	int pathLen = ustrlen(path);
+	stats.Allocated(sizeof(find_data_t) + sizeof(FILEDIR_CHAR) * (pathLen + 3));
 
 #ifdef _WIN32
 	data->basePath = new FILEDIR_CHAR[pathLen + 3];
@@ -178,50 +519,89 @@ static find_data_t *openFolderForSearch(const FILEDIR_CHAR *path)
 	data->basePathLength = pathLen;
 #endif
 
-#ifdef _WIN32
+	if (cache)
+	{
+		data->basePath[data->basePathLength] = '\0';
+		data->listing = cache->GetListing(path, &errorCode);
+		if (!data->listing)
+		{
+			data->release(stats);
+			delete data;
+			return NULL;
+		}
 
-	data->handle = FindFirstFileW(data->basePath, &data->data);
+		stats.EndPhase(FileDirStatsPhaseOpen, begin);
 
-	data->basePath[data->basePathLength] = '\0';
-	data->hasNext = data->handle != INVALID_HANDLE_VALUE;
+		data->listed = data->listing.get();
+		data->hasNext = !data->listing->entries.empty();
+		return data;
+	}
 
-	while (data->handle != INVALID_HANDLE_VALUE && data->data.cFileName[0] == '.' &&
-		(data->data.cFileName[1] == '\0' ||
-		(data->data.cFileName[1] == '.' && data->data.cFileName[2] == '\0')))
+#ifndef _WIN32
+	if (prefetcher)
 	{
-		if (FindNextFileW(data->handle, &data->data) == 0)
+		DIR *dir = opendir(path);
+		if (dir == NULL)
 		{
-			data->hasNext = false;
-			break;
+			errorCode = errno;
+			data->release(stats);
+			delete data;
+			return NULL;
 		}
+
+		stats.DirectoryOpened();
+		stats.EndPhase(FileDirStatsPhaseOpen, begin);
+
+		data->prefetcher = prefetcher;
+		data->prefetch = prefetcher->Open(dir);
+		data->listed = prefetcher->TakeBatch(data->prefetch, data->readError);
+		data->hasNext = data->listed != NULL;
+		return data;
 	}
+#else
+	(void)prefetcher;
+#endif
+
+#ifdef _WIN32
+
+	data->handle = FindFirstFileW(data->basePath, &data->data);
+	data->basePath[data->basePathLength] = '\0';
 
 	if (data->handle == INVALID_HANDLE_VALUE)
 	{
-		data->release();
+		errorCode = (int)GetLastError();
+		data->release(stats);
 		delete data;
 		data = NULL;
 	}
+	else
+	{
+		stats.DirectoryOpened();
+		stats.EndPhase(FileDirStatsPhaseOpen, begin);
+
+		data->hasNext = true;
+		if (IS_DOTS(data->data.cFileName))
+		{
+			readNextEntry(data, stats);
+		}
+	}
 
 #else
 
 	data->dir = opendir(path);
-	if (data->dir != NULL && (data->entry = readdir(data->dir)))
+	if (data->dir == NULL)
 	{
-		while (data->entry && data->entry->d_name[0] == '.' &&
-			(data->entry->d_name[1] == '\0' ||
-			(data->entry->d_name[1] == '.' && data->entry->d_name[2] == '\0')))
-		{
-			data->entry = readdir(data->dir);
-		}
-
-		data->hasNext = data->entry != NULL;
+		errorCode = errno;
+		data->release(stats);
+		delete data;
+		data = NULL;
 	}
 	else
 	{
-		data->release();
-		delete data;
-		data = NULL;
+		stats.DirectoryOpened();
+		stats.EndPhase(FileDirStatsPhaseOpen, begin);
+
+		readNextEntry(data, stats);
 	}
 
 #endif
@@ -232,12 +612,19 @@ static find_data_t *openFolderForSearch(const FILEDIR_CHAR *path)
 FileDirController::FileDirController(void)
 {
 	_isRecursive = false;
+	_errorHandler = NULL;
+	_errorHandlerContext = NULL;
+	_cache = NULL;
+	_prefetcher = NULL;
+	_prefetchDepth = 0;
+	_prefetchBatchSize = 0;
 	Close();
 }
 
 FileDirController::~FileDirController(void)
 {
 	Close();
+	SetPrefetch(0);
 }
 
 bool FileDirController::EnumerateFilesAtPath(const FILEDIR_CHAR *path, bool recursive/* = false*/)
@@ -248,29 +635,117 @@ bool FileDirController::EnumerateFilesAtPath(const FILEDIR_CHAR *path, bool recu
 
 	if (!path) return false;
 
-	find_data_t *find = openFolderForSearch(path);
-	if (find)
+#ifndef _WIN32
+	if (_prefetchDepth > 0 && !_prefetcher)
 	{
-		if (find->hasNext)
+		_prefetcher = new FileDirPrefetcher(_prefetchDepth, _prefetchBatchSize, _stats);
+	}
+#endif
+
+	return PushFolder(path);
+}
+
+void FileDirController::SetErrorHandler(FileDirErrorHandler handler, void *context/* = NULL*/)
+{
+	_errorHandler = handler;
+	_errorHandlerContext = context;
+}
+
+void FileDirController::SetCache(FileDirCache *cache)
+{
+	_cache = cache;
+}
+
+void FileDirController::SetPrefetch(int depth, int batchSize/* = 256*/)
+{
+	Close();
+
+#ifndef _WIN32
+	delete _prefetcher;
+#endif
+	_prefetcher = NULL;
+
+	_prefetchDepth = depth > 0 ? depth : 0;
+	_prefetchBatchSize = batchSize > 0 ? batchSize : 1;
+}
+
+bool FileDirController::PushFolder(const FILEDIR_CHAR *path)
+{
+	int errorCode = 0;
+	find_data_t *find = openFolderForSearch(path, _stats, errorCode, _cache, _prefetcher);
+	if (!find)
+	{
+		if (_errorHandler)
 		{
-			_searchTree.push_back((void *)find);
+			_errorHandler(path, errorCode, FileDirErrorPhaseOpen, _errorHandlerContext);
 		}
-		else
+		return false;
+	}
+
+	if (find->hasNext)
+	{
+		_searchTree.push_back((void *)find);
+		_stats.StackDepth(_searchTree.size());
+	}
+	else
+	{
+		if (find->readError && _errorHandler)
 		{
-			find->release();
-			delete find;
+			_errorHandler(path, find->readError, FileDirErrorPhaseRead, _errorHandlerContext);
 		}
-
-		return true;
+		find->release(_stats);
+		delete find;
 	}
 
-	return false;
+	return true;
 }
 
-FileDir * FileDirController::GetFileInfo(const FILEDIR_CHAR *path)
+FileDir * FileDirController::GetFileInfo(const FILEDIR_CHAR *path, FileDirCache *cache/* = NULL*/)
 {
 	if (!path || path[0] == '\0') return NULL;
 
+	if (cache)
+	{
+		int separatorIndex = FileDirPath::FindLastSeparator(path, (int)ustrlen(path));
+		const FILEDIR_CHAR *separator = separatorIndex == -1 ? NULL : path + separatorIndex;
+		const FILEDIR_CHAR *fileName = separator ? separator + 1 : path;
+
+		if (fileName[0] != '\0')
+		{
+			std::vector<FILEDIR_CHAR> parent;
+			if (separator)
+			{
+				int parentLength = separator == path ? 1 : (int)(separator - path);
+#ifdef _WIN32
+				if (parentLength == 2 && path[1] == ':') parentLength = 3; // Drive root
+#endif
+				parent.assign(path, path + parentLength);
+			}
+			else
+			{
+				parent.push_back('.');
+			}
+			parent.push_back('\0');
+
+			FileDirCacheListingRef listing = cache->FindListing(&parent[0]);
+			const FileDirCacheEntry *entry = listing ? listing->Find(fileName) : NULL;
+			if (entry && !entry->errorCode)
+			{
+				FileDir *fileDir = new FileDir();
+				fileDir->Assign(path, ustrlen(path), (int)(fileName - path));
+				fileDir->_isFile = entry->isFile;
+				fileDir->_isFolder = entry->isFolder;
+				fileDir->_creationTime = entry->creationTime;
+				fileDir->_lastModificationTime = entry->lastModificationTime;
+				fileDir->_lastAccessTime = entry->lastAccessTime;
+				fileDir->_lastStatusChangeTime = entry->lastStatusChangeTime;
+				fileDir->_hasTimes = true;
+				fileDir->_size = entry->size;
+				return fileDir;
+			}
+		}
+	}
+
 #ifdef _WIN32
 	DWORD dwFileAttributes = GetFileAttributes(path);
 	if (dwFileAttributes == INVALID_FILE_ATTRIBUTES)
@@ -286,18 +761,8 @@ FileDir * FileDirController::GetFileInfo(const FILEDIR_CHAR *path)
 #endif
 
 	FileDir *fileDir = new FileDir();
-	fileDir->_fullPath = ustrdup(path);
-
-	const FILEDIR_CHAR *separator = ustrrchr(path, '/');
-	if (!separator) separator = ustrrchr(path, '\\');
-	if (separator)
-	{
-		fileDir->_fileName = ustrdup(separator + 1);
-	}
-	else
-	{
-		fileDir->_fileName = ustrdup(path);
-	}
+	int pathLength = (int)ustrlen(path);
+	fileDir->Assign(path, pathLength, FileDirPath::GetFileNameOffset(path, pathLength));
 
 #ifdef _WIN32
 	fileDir->_isFile = IS_REGULAR_FILE(dwFileAttributes);
@@ -311,124 +776,360 @@ FileDir * FileDirController::GetFileInfo(const FILEDIR_CHAR *path)
 	fileDir->_lastAccessTime = fileStat.st_atime;
 	fileDir->_lastStatusChangeTime = fileStat.st_ctime;
 	fileDir->_hasTimes = true;
+	fileDir->_size = (long long)fileStat.st_size;
 #endif
 
 	return fileDir;
 }
 
-void FileDirController::Close()
+#ifdef _WIN32
+#define FILETIME_TO_TIME_T(FILETIME) ((time_t)(((((__int64)FILETIME.dwLowDateTime) | (((__int64)FILETIME.dwHighDateTime) << 32)) - 116444736000000000LL) / 10000000LL))
+#endif
+
+// Below this many paths per thread, spreading the work is not worth starting threads for
+#define MIN_BATCH_PATHS_PER_THREAD 256
+
+// Larger groups are split, so a single huge folder is still spread over the threads
+#define MAX_BATCH_GROUP_SIZE 1024
+
+// A path of a batch, and where its name starts. parentLength is -1 for paths without a parent folder.
+typedef struct _batch_path_t {
+	const FILEDIR_CHAR *path;
+	int parentLength;
+	int index;
+} batch_path_t;
+
+static bool isSameParent(const batch_path_t &a, const batch_path_t &b)
 {
-	for (std::list<void *>::iterator it = _searchTree.begin(), itEnd = _searchTree.end(); it != itEnd; it++)
-	{
-		find_data_t *data = (find_data_t *)*it;
-		data->release();
-		delete data;
-	}
-	_searchTree.clear();
+	return a.parentLength == b.parentLength &&
+		(a.parentLength <= 0 || memcmp(a.path, b.path, sizeof(FILEDIR_CHAR) * a.parentLength) == 0);
 }
 
-FileDir * FileDirController::NextFile()
+static bool isParentLess(const batch_path_t &a, const batch_path_t &b)
 {
-	if (_searchTree.empty()) return NULL;
+	int length = a.parentLength < b.parentLength ? a.parentLength : b.parentLength;
+	int compare = length > 0 ? memcmp(a.path, b.path, sizeof(FILEDIR_CHAR) * length) : 0;
+	if (compare != 0) return compare < 0;
+	return a.parentLength < b.parentLength;
+}
 
-	find_data_t *find = (find_data_t *)_searchTree.back();
+static void readBatchInfo(const FILEDIR_CHAR *path, FileDirInfo &info, int parentFd, const FILEDIR_CHAR *name)
+{
+	memset(&info, 0, sizeof(info));
 
-	int fileNameLength;
 #ifdef _WIN32
-	fileNameLength = (int)wcslen(find->data.cFileName);
+	(void)parentFd; (void)name;
+
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExW(path, GetFileExInfoStandard, &data))
+	{
+		info.errorCode = (int)GetLastError();
+		return;
+	}
+
+	info.isFile = IS_REGULAR_FILE(data.dwFileAttributes);
+	info.isFolder = IS_FOLDER(data.dwFileAttributes);
+	info.creationTime = FILETIME_TO_TIME_T(data.ftCreationTime);
+	info.lastModificationTime = FILETIME_TO_TIME_T(data.ftLastWriteTime);
+	info.lastAccessTime = FILETIME_TO_TIME_T(data.ftLastAccessTime);
+	info.lastStatusChangeTime = -1;
+	info.size = ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
 #else
-	fileNameLength = (int)strlen(find->entry->d_name);
+	struct stat fileStat;
+	int result = parentFd == -1 ? stat(path, &fileStat) : fstatat(parentFd, name, &fileStat, 0);
+	if (result == -1)
+	{
+		info.errorCode = errno;
+		return;
+	}
+
+	info.isFile = IS_REGULAR_FILE(fileStat.st_mode);
+	info.isFolder = IS_FOLDER(fileStat.st_mode);
+	info.creationTime = -1;
+	info.lastModificationTime = fileStat.st_mtime;
+	info.lastAccessTime = fileStat.st_atime;
+	info.lastStatusChangeTime = fileStat.st_ctime;
+	info.size = (long long)fileStat.st_size;
 #endif
+}
 
-	bool addSlash = find->basePath[find->basePathLength - 1] != '/' && find->basePath[find->basePathLength - 1] != '\\';
-	int slashLength = addSlash ? 1 : 0;
+// Reads the info of a group of paths sharing the same parent folder
+static void readBatchGroup(const batch_path_t *group, int count, FileDirInfo *results)
+{
+	int parentFd = -1;
 
-	int fullPathLength = find->basePathLength + slashLength + fileNameLength;
+#ifndef _WIN32
+	int parentLength = group[0].parentLength;
+	if (parentLength >= 0)
+	{
+		// The parent of "/name" is the root
+		std::vector<char> parent(group[0].path, group[0].path + (parentLength ? parentLength : 1));
+		parent.push_back('\0');
 
-#ifdef _WIN32
-	wchar_t *filePath = new FILEDIR_CHAR[fullPathLength + 1];
-	memcpy(filePath, find->basePath, sizeof(FILEDIR_CHAR) * find->basePathLength);
-	if (addSlash)
+#ifdef O_PATH
+		parentFd = open(&parent[0], O_PATH | O_DIRECTORY | O_CLOEXEC);
+#else
+		parentFd = open(&parent[0], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+		// When the folder cannot be opened, each path is stat()ed on its own to get its accurate error
+	}
+#endif
+
+	for (int i = 0; i < count; i++)
 	{
-		filePath[find->basePathLength] = '\\';
+		const batch_path_t &item = group[i];
+		readBatchInfo(item.path, results[item.index], parentFd, item.path + item.parentLength + 1);
 	}
-	memcpy(filePath + find->basePathLength + slashLength, find->data.cFileName, sizeof(FILEDIR_CHAR) * fileNameLength);
-	filePath[fullPathLength] = '\0';
-#else
-	char *filePath = new FILEDIR_CHAR[fullPathLength + 1];
-	memcpy(filePath, find->basePath, sizeof(FILEDIR_CHAR) * find->basePathLength);
-	if (addSlash)
+
+#ifndef _WIN32
+	if (parentFd != -1)
 	{
-		filePath[find->basePathLength] = '/';
+		close(parentFd);
 	}
-	memcpy(filePath + find->basePathLength + slashLength, find->entry->d_name, sizeof(FILEDIR_CHAR) * fileNameLength);
-	filePath[fullPathLength] = '\0';
 #endif
+}
 
-#ifndef WIN32
-	struct stat fileStat;
-	if (stat(filePath, &fileStat) == -1)
+int FileDirController::GetFileInfoBatch(const FILEDIR_CHAR * const *paths, int count, FileDirInfo *results, int threadCount/* = 0*/)
+{
+	if (!paths || !results || count <= 0) return 0;
+
+	std::vector<batch_path_t> items(count);
+	for (int i = 0; i < count; i++)
 	{
-		delete [] filePath;
-		return NULL;
-	}
+		batch_path_t &item = items[i];
+		item.path = paths[i];
+		item.index = i;
+		item.parentLength = -1;
+
+		if (!item.path || item.path[0] == '\0')
+		{
+			item.path = NULL;
+			continue;
+		}
+
+#ifndef _WIN32
+		const FILEDIR_CHAR *separator = ustrrchr(item.path, '/');
+		if (separator && separator[1] != '\0')
+		{
+			item.parentLength = (int)(separator - item.path);
+		}
 #endif
+	}
 
-	FileDir *fileDir = new FileDir();
-	fileDir->_fullPath = filePath;
+	// Empty paths fail right away, the rest are grouped by parent folder
+	std::vector<batch_path_t>::iterator validEnd = std::partition(items.begin(), items.end(), [](const batch_path_t &item) { return item.path != NULL; });
+	for (std::vector<batch_path_t>::iterator it = validEnd; it != items.end(); it++)
+	{
+		memset(&results[it->index], 0, sizeof(FileDirInfo));
 #ifdef _WIN32
-	fileDir->_fileName = wcsdup(find->data.cFileName); // Copy from the struct's memory
+		results[it->index].errorCode = ERROR_PATH_NOT_FOUND;
 #else
-	fileDir->_fileName = strdup(find->entry->d_name); // Copy from statically allocated memory
+		results[it->index].errorCode = ENOENT;
 #endif
+	}
+	items.erase(validEnd, items.end());
 
-#ifdef _WIN32
-	fileDir->_isFile = IS_REGULAR_FILE(find->data.dwFileAttributes);
-	fileDir->_isFolder = IS_FOLDER(find->data.dwFileAttributes);
-#else
-	fileDir->_isFile = IS_REGULAR_FILE(fileStat.st_mode);
-	fileDir->_isFolder = IS_FOLDER(fileStat.st_mode);
+	std::sort(items.begin(), items.end(), isParentLess);
 
-	fileDir->_creationTime = -1;
-	fileDir->_lastModificationTime = fileStat.st_mtime;
-	fileDir->_lastAccessTime = fileStat.st_atime;
-	fileDir->_lastStatusChangeTime = fileStat.st_ctime;
-	fileDir->_hasTimes = true;
-#endif
+	std::vector<std::pair<int, int> > groups; // [start, end) into items
+	for (int start = 0, end; start < (int)items.size(); start = end)
+	{
+		for (end = start + 1; end < (int)items.size() && end - start < MAX_BATCH_GROUP_SIZE && isSameParent(items[start], items[end]); end++);
+		groups.push_back(std::make_pair(start, end));
+	}
 
-	// Prepare for the next file
-#ifdef _WIN32
-	if (FindNextFileW(find->handle, &find->data) == 0)
+	if (threadCount <= 0)
 	{
-		find->release();
-		delete find;
-		_searchTree.pop_back();
+		threadCount = (int)std::thread::hardware_concurrency();
 	}
-#else
-	find->entry = readdir(find->dir);
-	if (find->entry == NULL)
+	int maxThreads = (int)items.size() / MIN_BATCH_PATHS_PER_THREAD;
+	if (threadCount > maxThreads) threadCount = maxThreads;
+	if (threadCount > (int)groups.size()) threadCount = (int)groups.size();
+	if (threadCount < 1) threadCount = 1;
+
+	std::atomic<size_t> nextGroup(0);
+	auto worker = [&]()
 	{
-		find->release();
-		delete find;
-		_searchTree.pop_back();
+		for (size_t group; (group = nextGroup.fetch_add(1, std::memory_order_relaxed)) < groups.size(); )
+		{
+			readBatchGroup(&items[groups[group].first], groups[group].second - groups[group].first, results);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++)
+	{
+		threads.push_back(std::thread(worker));
 	}
-#endif
+	worker();
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+
+	int succeeded = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (results[i].errorCode == 0) succeeded++;
+	}
+	return succeeded;
+}
+
+void FileDirController::GetStats(FileDirStatsSnapshot &snapshot) const
+{
+	_stats.Snapshot(snapshot);
+}
+
+void FileDirController::ResetStats()
+{
+	_stats.Reset();
+}
+
+void FileDirController::Close()
+{
+	for (std::list<void *>::iterator it = _searchTree.begin(), itEnd = _searchTree.end(); it != itEnd; it++)
+	{
+		find_data_t *data = (find_data_t *)*it;
+		data->release(_stats);
+		delete data;
+	}
+	_searchTree.clear();
+}
+
+FileDir * FileDirController::NextFile()
+{
+	FileDir *fileDir = new FileDir();
+
+	if (!NextFile(*fileDir))
+	{
+		delete fileDir;
+		return NULL;
+	}
+
+	_stats.Allocated(sizeof(FileDir));
+
+	return fileDir;
+}
 
-	if (_isRecursive && fileDir->_isFolder)
+bool FileDirController::NextFile(FileDir &fileDir)
+{
+	uint64_t nextFileBegin = _stats.BeginPhase();
+
+	int capacity = fileDir._fullPathCapacity;
+	bool found = false;
+
+	while (!found && !_searchTree.empty())
 	{
-		find = openFolderForSearch(fileDir->GetFullPath());
-		if (find)
+		find_data_t *find = (find_data_t *)_searchTree.back();
+		_stats.EntryRead();
+
+		const FileDirCacheEntry *cacheEntry = find->listed ? &find->listed->entries[find->listedIndex] : NULL;
+
+		const FILEDIR_CHAR *entryName;
+		if (cacheEntry)
+		{
+			entryName = find->listed->GetName(*cacheEntry);
+		}
+		else
 		{
-			if (find->hasNext)
+#ifdef _WIN32
+			entryName = find->data.cFileName;
+#else
+			entryName = find->entry->d_name;
+#endif
+		}
+
+		// Copy from the struct's memory / statically allocated memory, into the buffer of the previous entry
+		fileDir.AssignJoined(find->basePath, find->basePathLength, entryName, (int)ustrlen(entryName));
+		const FILEDIR_CHAR *filePath = fileDir._fullPath;
+
+		if (cacheEntry)
+		{
+			if (cacheEntry->errorCode == 0)
 			{
-				_searchTree.push_back((void *)find);
+				fileDir._isFile = cacheEntry->isFile;
+				fileDir._isFolder = cacheEntry->isFolder;
+				fileDir._creationTime = cacheEntry->creationTime;
+				fileDir._lastModificationTime = cacheEntry->lastModificationTime;
+				fileDir._lastAccessTime = cacheEntry->lastAccessTime;
+				fileDir._lastStatusChangeTime = cacheEntry->lastStatusChangeTime;
+				fileDir._hasTimes = true;
+				fileDir._size = cacheEntry->size;
+				found = true;
 			}
-			else
+			else if (_errorHandler)
+			{
+				_errorHandler(filePath, cacheEntry->errorCode, FileDirErrorPhaseStat, _errorHandlerContext);
+			}
+		}
+		else
+		{
+#ifdef _WIN32
+			fileDir._isFile = IS_REGULAR_FILE(find->data.dwFileAttributes);
+			fileDir._isFolder = IS_FOLDER(find->data.dwFileAttributes);
+			fileDir._size = ((long long)find->data.nFileSizeHigh << 32) | find->data.nFileSizeLow;
+			found = true;
+#else
+			uint64_t statBegin = _stats.BeginPhase();
+			struct stat fileStat;
+			bool statSucceeded = stat(filePath, &fileStat) != -1;
+			int statError = statSucceeded ? 0 : errno;
+			_stats.EndPhase(FileDirStatsPhaseStat, statBegin);
+			_stats.StatIssued(statSucceeded);
+
+			if (statSucceeded)
+			{
+				fileDir._isFile = IS_REGULAR_FILE(fileStat.st_mode);
+				fileDir._isFolder = IS_FOLDER(fileStat.st_mode);
+
+				fileDir._creationTime = -1;
+				fileDir._lastModificationTime = fileStat.st_mtime;
+				fileDir._lastAccessTime = fileStat.st_atime;
+				fileDir._lastStatusChangeTime = fileStat.st_ctime;
+				fileDir._hasTimes = true;
+				fileDir._size = (long long)fileStat.st_size;
+				found = true;
+			}
+			else if (_errorHandler)
 			{
-				delete find;
+				_errorHandler(filePath, statError, FileDirErrorPhaseStat, _errorHandlerContext);
 			}
+#endif
+		}
+
+		// Prepare for the next file
+		if (!readNextEntry(find, _stats))
+		{
+			if (find->readError && _errorHandler)
+			{
+				_errorHandler(find->basePath, find->readError, FileDirErrorPhaseRead, _errorHandlerContext);
+			}
+			find->release(_stats);
+			delete find;
+			_searchTree.pop_back();
+
+#ifndef _WIN32
+			// Resume reading ahead the parent folder
+			if (!_searchTree.empty() && ((find_data_t *)_searchTree.back())->prefetch)
+			{
+				_prefetcher->SetTarget(((find_data_t *)_searchTree.back())->prefetch);
+			}
+#endif
+		}
+
+		if (found && _isRecursive && fileDir._isFolder)
+		{
+			PushFolder(fileDir._fullPath);
 		}
 	}
 
-	return fileDir;
+	// Only count the path buffer when it had to grow
+	if (fileDir._fullPathCapacity > capacity)
+	{
+		_stats.Allocated(sizeof(FILEDIR_CHAR) * (fileDir._fullPathCapacity - capacity));
+	}
+
+	_stats.EndPhase(FileDirStatsPhaseNextFile, nextFileBegin);
+
+	return found;
 }
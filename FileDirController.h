@@ -33,6 +33,10 @@
 #pragma once
 
 #include "FileDir.h"
+#include "FileDirStats.h"
+
+class FileDirCache;
+class FileDirPrefetcher;
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -43,6 +47,34 @@
 
 #include <list>
 
+enum FileDirErrorPhase
+{
+	FileDirErrorPhaseOpen, // A folder could not be opened
+	FileDirErrorPhaseRead, // Reading a folder's entries failed midway
+	FileDirErrorPhaseStat, // An entry's metadata could not be read (i.e. it was deleted during the scan)
+};
+
+// Called for each entry or folder that had to be skipped during enumeration.
+// errorCode is errno on POSIX, or GetLastError() on Windows.
+#ifdef _WIN32 /* Wide char */
+typedef void (*FileDirErrorHandler)(const wchar_t *path, int errorCode, FileDirErrorPhase phase, void *context);
+#else /* UTF8 */
+typedef void (*FileDirErrorHandler)(const char *path, int errorCode, FileDirErrorPhase phase, void *context);
+#endif
+
+// The info of a single path, as filled by FileDirController::GetFileInfoBatch()
+struct FileDirInfo
+{
+	int errorCode; // 0 on success, otherwise errno on POSIX, or GetLastError() on Windows
+	bool isFile;
+	bool isFolder;
+	time_t creationTime; // -1 when unknown
+	time_t lastModificationTime;
+	time_t lastAccessTime;
+	time_t lastStatusChangeTime; // -1 when unknown
+	long long size;
+};
+
 class FileDirController
 {
 public:
@@ -54,19 +86,71 @@ public:
 #else /* UTF8 */
 	bool EnumerateFilesAtPath(const char *path, bool recursive = false);
 #endif
+	// Returns the next entry, or NULL when there are no more entries.
+	// Entries that fail are skipped and reported to the error handler.
 	FileDir * NextFile();
+	// Same as NextFile(), but refills fileDir in place and returns false when there are no more entries.
+	// The path buffer is reused, so a loop over one FileDir stops allocating once it has seen the longest path.
+	bool NextFile(FileDir &fileDir);
+	// When a cache is given, and the parent folder's listing is cached and still valid, the info is taken from it
+#ifdef _WIN32 /* Wide char */
+	static FileDir * GetFileInfo(const wchar_t *path, FileDirCache *cache = NULL);
+#else /* UTF8 */
+	static FileDir * GetFileInfo(const char *path, FileDirCache *cache = NULL);
+#endif
+
+	// Reads the info of many paths at once, into results[0, count) in the same order as paths.
+	// Paths are grouped by their parent folder, so each folder is opened once and its entries are stat()ed relative to it.
+	// The groups are spread over threadCount threads (0 for one per core).
+	// Returns the number of paths whose info was read successfully.
 #ifdef _WIN32 /* Wide char */
-	static FileDir * GetFileInfo(const wchar_t *path);
+	static int GetFileInfoBatch(const wchar_t * const *paths, int count, FileDirInfo *results, int threadCount = 0);
 #else /* UTF8 */
-	static FileDir * GetFileInfo(const char *path);
+	static int GetFileInfoBatch(const char * const *paths, int count, FileDirInfo *results, int threadCount = 0);
 #endif
+
 	void Close();
 
 	inline bool HasNext() { return !_searchTree.empty(); }
 
+	// Sets a handler to be notified of entries and folders that are skipped due to errors
+	void SetErrorHandler(FileDirErrorHandler handler, void *context = NULL);
+
+	// Lists folders through a cache (i.e. FileDirCache::Shared()), or directly when NULL
+	void SetCache(FileDirCache *cache);
+
+	// Reads folders ahead on a background thread, up to depth batches of batchSize entries (and their metadata).
+	// Memory stays bounded by the depth, however large the folder. Depth 0 reads synchronously, which is the default.
+	// Ends the current enumeration. Not supported on Windows, where this has no effect.
+	void SetPrefetch(int depth, int batchSize = 256);
+
+	// Copies the statistics collected so far. May be called from another thread during a scan.
+	// Everything stays zero unless compiled with FILEDIR_ENABLE_STATS.
+	void GetStats(FileDirStatsSnapshot &snapshot) const;
+
+	// Zeroes the statistics collected so far
+	void ResetStats();
+
 private:
+#ifdef _WIN32 /* Wide char */
+	bool PushFolder(const wchar_t *path);
+#else /* UTF8 */
+	bool PushFolder(const char *path);
+#endif
+
 	bool _isRecursive;
 
+	FileDirErrorHandler _errorHandler;
+	void *_errorHandlerContext;
+
+	FileDirCache *_cache;
+
+	FileDirPrefetcher *_prefetcher;
+	int _prefetchDepth;
+	int _prefetchBatchSize;
+
+	FileDirStats _stats;
+
 	std::list<void *> _searchTree;
 };
 
@@ -0,0 +1,549 @@
+//
+//  FileDirEnumerator.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#pragma once
+
+#include "FileDir.h"
+#include "FileDirController.h"
+#include "FileDirStats.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// How much is known about each entry returned by NextFile()
+enum FileDirMetadataLevel
+{
+	FileDirMetadataNames, // Only the path and the name
+	FileDirMetadataType, // Also IsFile() / IsFolder(), taken from the folder listing when the file system provides it
+	FileDirMetadataFull, // Also the times, which costs a stat() per entry on POSIX
+};
+
+enum FileDirSymlinkPolicy
+{
+	FileDirSymlinkFollow, // Symbolic links are reported as their targets, and recursed into when they point to folders
+	FileDirSymlinkNoFollow, // Symbolic links are reported as themselves (neither file nor folder), and never recursed into
+};
+
+// Each NextFile() returns a new FileDir, which the caller deletes
+struct FileDirHeapAllocation {};
+
+// NextFile() refills and returns the same FileDir each time.
+// It is owned by the enumerator, and is only valid until the next call.
+struct FileDirReuseAllocation {};
+
+template <bool Recursive, FileDirMetadataLevel Metadata, FileDirSymlinkPolicy Symlinks = FileDirSymlinkFollow, class Allocation = FileDirHeapAllocation>
+struct FileDirEnumeratorPolicy
+{
+	static const bool recursive = Recursive;
+	static const FileDirMetadataLevel metadata = Metadata;
+	static const FileDirSymlinkPolicy symlinks = Symlinks;
+	typedef Allocation allocation;
+};
+
+// An enumerator which is configured at compile time, so each NextFile() does only the work the policy asks for.
+// i.e. BasicFileDirEnumerator< FileDirEnumeratorPolicy<true, FileDirMetadataType> > walks a tree without any stat() calls
+// on file systems which report entry types in the listing.
+template <class Policy>
+class BasicFileDirEnumerator
+{
+public:
+#ifdef _WIN32 /* Wide char */
+	typedef wchar_t CharType;
+#else /* UTF8 */
+	typedef char CharType;
+#endif
+
+	BasicFileDirEnumerator(void)
+	{
+		_errorHandler = NULL;
+		_errorHandlerContext = NULL;
+		_entry = NULL;
+	}
+
+	virtual ~BasicFileDirEnumerator(void)
+	{
+		Close();
+		delete _entry;
+	}
+
+	bool EnumerateFilesAtPath(const CharType *path)
+	{
+		Close();
+
+		if (!path) return false;
+
+		size_t pathLength = 0;
+		while (path[pathLength]) pathLength++;
+
+		_path.resize(pathLength + 1);
+		memcpy(&_path[0], path, sizeof(CharType) * (pathLength + 1));
+
+		return PushFolder(pathLength, 0);
+	}
+
+	FileDir * NextFile()
+	{
+		uint64_t nextFileBegin = _stats.BeginPhase();
+
+		while (HasNext())
+		{
+			Folder &folder = _folders.back();
+			_stats.EntryRead();
+
+#ifdef _WIN32
+			const CharType *name = folder.data.cFileName;
+#else
+			const CharType *name = folder.entry->d_name;
+#endif
+			size_t nameLength = 0;
+			while (name[nameLength]) nameLength++;
+
+			size_t nameOffset = folder.basePathLength + (folder.addSeparator ? 1 : 0);
+			size_t pathLength = nameOffset + nameLength;
+			if (_path.size() < pathLength + 1)
+			{
+				_path.resize(pathLength + 1);
+			}
+			if (folder.addSeparator)
+			{
+#ifdef _WIN32
+				_path[folder.basePathLength] = '\\';
+#else
+				_path[folder.basePathLength] = '/';
+#endif
+			}
+			memcpy(&_path[nameOffset], name, sizeof(CharType) * nameLength);
+			_path[pathLength] = '\0';
+
+			Metadata metadata;
+			bool succeeded = ReadMetadata(folder, metadata);
+
+			FileDir *fileDir = NULL;
+			if (succeeded)
+			{
+				fileDir = AcquireEntry(typename Policy::allocation());
+				fileDir->Assign(&_path[0], (int)pathLength, (int)nameOffset);
+				fileDir->_isFile = metadata.isFile;
+				fileDir->_isFolder = metadata.isFolder;
+				if (metadata.hasTimes)
+				{
+					fileDir->_creationTime = metadata.creationTime;
+					fileDir->_lastModificationTime = metadata.lastModificationTime;
+					fileDir->_lastAccessTime = metadata.lastAccessTime;
+					fileDir->_lastStatusChangeTime = metadata.lastStatusChangeTime;
+					fileDir->_hasTimes = true;
+					fileDir->_size = metadata.size;
+				}
+			}
+			else if (_errorHandler)
+			{
+				_errorHandler(&_path[0], metadata.errorCode, FileDirErrorPhaseStat, _errorHandlerContext);
+			}
+
+			// Prepare for the next file. Exhausted folders stay open until their subfolders are done,
+			// as the subfolders are opened relative to them.
+			if (!ReadNextEntry(folder) && folder.readError && _errorHandler)
+			{
+				CharType saved = _path[folder.basePathLength];
+				_path[folder.basePathLength] = '\0';
+				_errorHandler(&_path[0], folder.readError, FileDirErrorPhaseRead, _errorHandlerContext);
+				_path[folder.basePathLength] = saved;
+			}
+
+			if (!fileDir) continue;
+
+			if (Policy::recursive && metadata.isFolder)
+			{
+				PushFolder(pathLength, nameOffset);
+			}
+
+			_stats.EndPhase(FileDirStatsPhaseNextFile, nextFileBegin);
+
+			return fileDir;
+		}
+
+		_stats.EndPhase(FileDirStatsPhaseNextFile, nextFileBegin);
+
+		return NULL;
+	}
+
+	inline bool HasNext()
+	{
+		while (!_folders.empty() && !_folders.back().hasNext)
+		{
+			PopFolder();
+		}
+		return !_folders.empty();
+	}
+
+	void Close()
+	{
+		while (!_folders.empty())
+		{
+			PopFolder();
+		}
+	}
+
+	// Sets a handler to be notified of entries and folders that are skipped due to errors
+	void SetErrorHandler(FileDirErrorHandler handler, void *context = NULL)
+	{
+		_errorHandler = handler;
+		_errorHandlerContext = context;
+	}
+
+	// Copies the statistics collected so far. May be called from another thread during a scan.
+	void GetStats(FileDirStatsSnapshot &snapshot) const
+	{
+		_stats.Snapshot(snapshot);
+	}
+
+private:
+
+	struct Folder
+	{
+#ifdef _WIN32
+		HANDLE handle;
+		WIN32_FIND_DATAW data;
+#else
+		DIR *dir;
+		dirent *entry;
+#endif
+		bool hasNext;
+		int readError;
+		size_t basePathLength;
+		bool addSeparator;
+	};
+
+	struct Metadata
+	{
+		bool isFile;
+		bool isFolder;
+		bool hasTimes;
+		int errorCode;
+		time_t creationTime;
+		time_t lastModificationTime;
+		time_t lastAccessTime;
+		time_t lastStatusChangeTime;
+		long long size;
+	};
+
+	static inline bool IsDots(const CharType *name)
+	{
+		return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+	}
+
+	inline FileDir * AcquireEntry(FileDirHeapAllocation)
+	{
+		_stats.Allocated(sizeof(FileDir));
+		return new FileDir();
+	}
+
+	inline FileDir * AcquireEntry(FileDirReuseAllocation)
+	{
+		if (!_entry)
+		{
+			_stats.Allocated(sizeof(FileDir));
+			_entry = new FileDir();
+		}
+		return _entry;
+	}
+
+#ifdef _WIN32
+	static inline time_t FileTimeToTime(const FILETIME &fileTime)
+	{
+		return (time_t)(((((__int64)fileTime.dwLowDateTime) | (((__int64)fileTime.dwHighDateTime) << 32)) - 116444736000000000LL) / 10000000LL);
+	}
+#endif
+
+	// Fills in the metadata of the folder's current entry, whose full path is in _path
+	inline bool ReadMetadata(Folder &folder, Metadata &metadata)
+	{
+		metadata.isFile = metadata.isFolder = metadata.hasTimes = false;
+		metadata.errorCode = 0;
+
+#ifdef _WIN32
+
+		DWORD attributes = folder.data.dwFileAttributes;
+		bool isLink = Policy::symlinks == FileDirSymlinkNoFollow && (attributes & FILE_ATTRIBUTE_REPARSE_POINT);
+		if (!isLink)
+		{
+			metadata.isFolder = !!(attributes & FILE_ATTRIBUTE_DIRECTORY);
+			metadata.isFile = !metadata.isFolder && !(attributes & FILE_ATTRIBUTE_DEVICE);
+		}
+
+		if (Policy::metadata == FileDirMetadataFull)
+		{
+			metadata.creationTime = FileTimeToTime(folder.data.ftCreationTime);
+			metadata.lastModificationTime = FileTimeToTime(folder.data.ftLastWriteTime);
+			metadata.lastAccessTime = FileTimeToTime(folder.data.ftLastAccessTime);
+			metadata.lastStatusChangeTime = -1;
+			metadata.size = ((long long)folder.data.nFileSizeHigh << 32) | folder.data.nFileSizeLow;
+			metadata.hasTimes = true;
+		}
+
+		return true;
+
+#else
+
+		if (Policy::metadata == FileDirMetadataNames && !Policy::recursive)
+		{
+			return true;
+		}
+
+		bool needsStat = Policy::metadata == FileDirMetadataFull;
+
+#ifdef DT_UNKNOWN
+		if (!needsStat)
+		{
+			unsigned char type = folder.entry->d_type;
+			if (type == DT_UNKNOWN || (type == DT_LNK && Policy::symlinks == FileDirSymlinkFollow))
+			{
+				needsStat = true;
+			}
+			else
+			{
+				metadata.isFolder = type == DT_DIR;
+				metadata.isFile = type == DT_REG;
+			}
+		}
+#else
+		needsStat = true;
+#endif
+
+		if (!needsStat)
+		{
+			return true;
+		}
+
+		uint64_t statBegin = _stats.BeginPhase();
+		struct stat fileStat;
+		bool statSucceeded = fstatat(dirfd(folder.dir), folder.entry->d_name, &fileStat,
+			Policy::symlinks == FileDirSymlinkFollow ? 0 : AT_SYMLINK_NOFOLLOW) != -1;
+		metadata.errorCode = statSucceeded ? 0 : errno;
+		_stats.EndPhase(FileDirStatsPhaseStat, statBegin);
+		_stats.StatIssued(statSucceeded);
+
+		if (!statSucceeded)
+		{
+			return false;
+		}
+
+		metadata.isFile = S_ISREG(fileStat.st_mode);
+		metadata.isFolder = S_ISDIR(fileStat.st_mode);
+
+		if (Policy::metadata == FileDirMetadataFull)
+		{
+			metadata.creationTime = -1;
+			metadata.lastModificationTime = fileStat.st_mtime;
+			metadata.lastAccessTime = fileStat.st_atime;
+			metadata.lastStatusChangeTime = fileStat.st_ctime;
+			metadata.size = (long long)fileStat.st_size;
+			metadata.hasTimes = true;
+		}
+
+		return true;
+
+#endif
+	}
+
+	// Moves to the next entry, skipping "." and "..".
+	// Returns false at the end of the folder, or when reading failed (readError is set).
+	inline bool ReadNextEntry(Folder &folder)
+	{
+		uint64_t begin = _stats.BeginPhase();
+
+#ifdef _WIN32
+		do
+		{
+			if (FindNextFileW(folder.handle, &folder.data) == 0)
+			{
+				DWORD error = GetLastError();
+				folder.readError = error == ERROR_NO_MORE_FILES ? 0 : (int)error;
+				folder.hasNext = false;
+				break;
+			}
+			folder.hasNext = true;
+		}
+		while (IsDots(folder.data.cFileName));
+#else
+		do
+		{
+			errno = 0;
+			folder.entry = readdir(folder.dir);
+			if (folder.entry == NULL)
+			{
+				folder.readError = errno;
+				break;
+			}
+		}
+		while (IsDots(folder.entry->d_name));
+
+		folder.hasNext = folder.entry != NULL;
+#endif
+
+		_stats.EndPhase(FileDirStatsPhaseRead, begin);
+
+		return folder.hasNext;
+	}
+
+	// Opens the folder whose path is in _path[0, pathLength), and whose name starts at nameOffset.
+	// Nested folders are opened relative to their parent, which is the current top of the stack.
+	bool PushFolder(size_t pathLength, size_t nameOffset)
+	{
+		uint64_t begin = _stats.BeginPhase();
+
+		Folder folder;
+		folder.readError = 0;
+		folder.hasNext = false;
+		folder.basePathLength = pathLength;
+		folder.addSeparator = pathLength > 0 && _path[pathLength - 1] != '/' && _path[pathLength - 1] != '\\';
+
+		int errorCode = 0;
+
+#ifdef _WIN32
+		(void)nameOffset;
+
+		if (_path.size() < pathLength + 3)
+		{
+			_path.resize(pathLength + 3);
+		}
+		_path[pathLength] = '\\';
+		_path[pathLength + 1] = '*';
+		_path[pathLength + 2] = '\0';
+
+		folder.handle = FindFirstFileExW(&_path[0],
+			Policy::metadata == FileDirMetadataFull ? FindExInfoStandard : FindExInfoBasic,
+			&folder.data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+
+		_path[pathLength] = '\0';
+
+		if (folder.handle == INVALID_HANDLE_VALUE)
+		{
+			errorCode = (int)GetLastError();
+		}
+		else
+		{
+			folder.hasNext = true;
+		}
+#else
+		int fd;
+		if (_folders.empty())
+		{
+			fd = open(&_path[0], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		}
+		else
+		{
+			fd = openat(dirfd(_folders.back().dir), &_path[nameOffset],
+				O_RDONLY | O_DIRECTORY | O_CLOEXEC | (Policy::symlinks == FileDirSymlinkNoFollow ? O_NOFOLLOW : 0));
+		}
+
+		folder.dir = fd == -1 ? NULL : fdopendir(fd);
+		if (folder.dir == NULL)
+		{
+			errorCode = errno;
+			if (fd != -1)
+			{
+				close(fd);
+			}
+		}
+		folder.entry = NULL;
+#endif
+
+		if (errorCode)
+		{
+			if (_errorHandler)
+			{
+				_errorHandler(&_path[0], errorCode, FileDirErrorPhaseOpen, _errorHandlerContext);
+			}
+			return false;
+		}
+
+		_stats.DirectoryOpened();
+		_stats.EndPhase(FileDirStatsPhaseOpen, begin);
+
+		_folders.push_back(folder);
+		_stats.StackDepth(_folders.size());
+
+		Folder &pushed = _folders.back();
+#ifdef _WIN32
+		if (IsDots(pushed.data.cFileName))
+		{
+			ReadNextEntry(pushed);
+		}
+#else
+		ReadNextEntry(pushed);
+#endif
+
+		if (!pushed.hasNext && pushed.readError && _errorHandler)
+		{
+			_errorHandler(&_path[0], pushed.readError, FileDirErrorPhaseRead, _errorHandlerContext);
+		}
+
+		return true;
+	}
+
+	void PopFolder()
+	{
+		Folder &folder = _folders.back();
+#ifdef _WIN32
+		FindClose(folder.handle);
+#else
+		closedir(folder.dir);
+#endif
+		_stats.DirectoryClosed();
+		_folders.pop_back();
+	}
+
+	std::vector<Folder> _folders;
+
+	// The path of the current entry. The paths of all open folders are prefixes of it.
+	std::vector<CharType> _path;
+
+	FileDir *_entry;
+
+	FileDirErrorHandler _errorHandler;
+	void *_errorHandlerContext;
+
+	FileDirStats _stats;
+};
@@ -0,0 +1,405 @@
+//
+//  FileDirEstimator.cpp
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "FileDirEstimator.h"
+#include "FileDirEnumerator.h"
+
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef FILEDIR_CHAR
+
+#ifdef _WIN32
+#define FILEDIR_CHAR wchar_t
+#else
+#define FILEDIR_CHAR char
+#endif
+
+#endif
+
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+// After this many probes in a row that did not read any new folder, the rest of the tree is read directly
+#define MAX_PROBES_WITHOUT_READS 256
+
+// The two sided 95% quantile of the normal distribution
+#define CONFIDENCE_Z 1.96
+
+typedef std::basic_string<FILEDIR_CHAR> estimate_path_t;
+
+// Reads a single folder, with entry types but without following symbolic links.
+// The listing has the sizes on Windows, elsewhere only a sample of the files is stat()ed.
+#ifdef _WIN32
+typedef BasicFileDirEnumerator< FileDirEnumeratorPolicy<false, FileDirMetadataFull, FileDirSymlinkNoFollow, FileDirReuseAllocation> > folder_enumerator_t;
+#else
+typedef BasicFileDirEnumerator< FileDirEnumeratorPolicy<false, FileDirMetadataType, FileDirSymlinkNoFollow, FileDirReuseAllocation> > folder_enumerator_t;
+#endif
+
+// What is known of a folder once it was read
+typedef struct _sampled_folder_t {
+	double entries;
+	double files;
+	double bytes; // Estimated from a sample of the files on POSIX
+	double bytesVariance; // Of the sampled estimate, 0 when all sizes were read
+	bool bytesExact; // The size of every file was read
+	std::vector<estimate_path_t> subFolders; // Full paths, each with a trailing separator
+} sampled_folder_t;
+
+// A running mean and variance, see Welford's algorithm
+typedef struct _running_stat_t {
+	int count;
+	double mean;
+	double m2;
+} running_stat_t;
+
+static void addSample(running_stat_t &stat, double value)
+{
+	stat.count++;
+	double delta = value - stat.mean;
+	stat.mean += delta / stat.count;
+	stat.m2 += delta * (value - stat.mean);
+}
+
+// Sets the estimate and its interval from the known part (with the variance of its sampling, if any) and the probes
+// of the rest, never going below what is known to exist
+static void setEstimate(double exact, double exactVariance, const running_stat_t &rest, bool hasRest, double known, double &value, double &low, double &high)
+{
+	double mean = exact + (hasRest ? rest.mean : 0);
+	value = mean > known ? mean : known;
+
+	if (hasRest && rest.count < 2)
+	{
+		low = known;
+		high = HUGE_VAL;
+		return;
+	}
+
+	double variance = exactVariance + (hasRest ? rest.m2 / (rest.count - 1) / rest.count : 0);
+	double margin = CONFIDENCE_Z * sqrt(variance);
+	low = mean - margin > known ? mean - margin : known;
+	high = mean + margin > value ? mean + margin : value;
+}
+
+// The state of a single Estimate()
+struct FileDirEstimator::Sampler
+{
+	Sampler(FileDirEstimator &owner, uint64_t seed) : estimator(owner), random(seed), foldersRead(0), unreadFolders(1) { }
+
+	FileDirEstimator &estimator;
+	std::mt19937_64 random;
+
+	std::unordered_map<estimate_path_t, sampled_folder_t> folders;
+	int foldersRead;
+	long long unreadFolders; // Folders seen but not read yet, starting with the root. Zero once the whole tree was read.
+
+	// Returns a folder, reading it on first use. A folder that could not be read is empty.
+	const sampled_folder_t & Get(const estimate_path_t &path, bool *readable = NULL)
+	{
+		std::unordered_map<estimate_path_t, sampled_folder_t>::iterator it = folders.find(path);
+		if (it != folders.end())
+		{
+			if (readable) *readable = true;
+			return it->second;
+		}
+
+		sampled_folder_t &folder = folders[path];
+		folder.entries = folder.files = folder.bytes = folder.bytesVariance = 0;
+		folder.bytesExact = false;
+
+		bool succeeded = Read(path, folder);
+		if (readable) *readable = succeeded;
+
+		unreadFolders += (long long)folder.subFolders.size() - 1;
+		return folder;
+	}
+
+	void AddSubFolder(sampled_folder_t &folder, const estimate_path_t &path, const FILEDIR_CHAR *name)
+	{
+		folder.subFolders.push_back(path);
+		folder.subFolders.back().append(name);
+		folder.subFolders.back().push_back(PATH_SEPARATOR);
+	}
+
+	bool Read(const estimate_path_t &path, sampled_folder_t &folder)
+	{
+		folder_enumerator_t enumerator;
+		if (!enumerator.EnumerateFilesAtPath(path.c_str())) return false;
+		foldersRead++;
+
+#ifdef _WIN32
+		while (FileDir *entry = enumerator.NextFile())
+		{
+			folder.entries++;
+
+			if (entry->IsFolder())
+			{
+				AddSubFolder(folder, path, entry->GetFileName());
+			}
+			else if (entry->IsFile())
+			{
+				folder.files++;
+				folder.bytes += (double)entry->GetSize();
+			}
+		}
+
+		folder.bytesExact = true;
+#else
+		// A uniform sample of the files, for their sizes
+		int sampleLimit = estimator._sizeSamplesPerFolder;
+		std::vector<std::string> samples;
+		long long sampledFiles = 0;
+
+		while (FileDir *entry = enumerator.NextFile())
+		{
+			folder.entries++;
+
+			if (entry->IsFolder())
+			{
+				AddSubFolder(folder, path, entry->GetFileName());
+				continue;
+			}
+			if (!entry->IsFile()) continue;
+
+			folder.files++;
+			if (sampleLimit <= 0) continue;
+
+			if (sampledFiles < sampleLimit)
+			{
+				samples.push_back(entry->GetFileName());
+			}
+			else
+			{
+				long long index = std::uniform_int_distribution<long long>(0, sampledFiles)(random);
+				if (index < sampleLimit) samples[(size_t)index] = entry->GetFileName();
+			}
+			sampledFiles++;
+		}
+
+		// Relative to the folder, which is cheaper than resolving each full path
+		running_stat_t sizes = { 0, 0, 0 };
+		int folderFd = samples.empty() ? -1 : open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (folderFd != -1)
+		{
+			for (size_t i = 0; i < samples.size(); i++)
+			{
+				struct stat fileStat;
+				if (fstatat(folderFd, samples[i].c_str(), &fileStat, AT_SYMLINK_NOFOLLOW) == -1) continue;
+				addSample(sizes, (double)fileStat.st_size);
+			}
+			close(folderFd);
+		}
+
+		if (sizes.count)
+		{
+			double total = (double)sampledFiles;
+			folder.bytes = sizes.mean * total;
+
+			// The variance of a total estimated from a sample without replacement
+			if (sizes.count > 1 && sizes.count < total)
+			{
+				folder.bytesVariance = total * total * (sizes.m2 / (sizes.count - 1)) / sizes.count * (1 - sizes.count / total);
+			}
+		}
+
+		folder.bytesExact = sizes.count == folder.files;
+#endif
+
+		return true;
+	}
+};
+
+FileDirEstimator::FileDirEstimator(void)
+{
+	_folderBudget = 1000;
+	_timeBudget = 50;
+	_sizeSamplesPerFolder = 16;
+	_seed = 0;
+	_hasSeed = false;
+}
+
+FileDirEstimator::~FileDirEstimator(void)
+{
+}
+
+void FileDirEstimator::SetFolderBudget(int folderBudget)
+{
+	_folderBudget = folderBudget;
+}
+
+void FileDirEstimator::SetTimeBudget(int milliseconds)
+{
+	_timeBudget = milliseconds;
+}
+
+void FileDirEstimator::SetSizeSamplesPerFolder(int samples)
+{
+	_sizeSamplesPerFolder = samples;
+}
+
+void FileDirEstimator::SetSeed(uint64_t seed)
+{
+	_seed = seed;
+	_hasSeed = true;
+}
+
+bool FileDirEstimator::Estimate(const FILEDIR_CHAR *path, FileDirEstimate &estimate)
+{
+	memset(&estimate, 0, sizeof(estimate));
+	if (!path || path[0] == '\0') return false;
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point deadline = begin + std::chrono::milliseconds(_timeBudget);
+
+	uint64_t seed = _seed;
+	if (!_hasSeed)
+	{
+		std::random_device device;
+		seed = ((uint64_t)device() << 32) ^ device();
+	}
+
+	Sampler sampler(*this, seed);
+
+	estimate_path_t root(path);
+	if (root[root.size() - 1] != '/' && root[root.size() - 1] != '\\')
+	{
+		root.push_back(PATH_SEPARATOR);
+	}
+
+	bool readable;
+	sampler.Get(root, &readable);
+	if (!readable) return false;
+
+	running_stat_t entries = { 0, 0, 0 }, files = { 0, 0, 0 }, folders = { 0, 0, 0 }, bytes = { 0, 0, 0 };
+	int probesWithoutReads = 0;
+
+	while (sampler.unreadFolders > 0 &&
+		sampler.foldersRead < _folderBudget &&
+		probesWithoutReads < MAX_PROBES_WITHOUT_READS &&
+		std::chrono::steady_clock::now() < deadline)
+	{
+		int foldersRead = sampler.foldersRead;
+		double weight = 1, probeEntries = 0, probeFiles = 0, probeFolders = 0, probeBytes = 0;
+
+		for (const estimate_path_t *current = &root; ; )
+		{
+			const sampled_folder_t &folder = sampler.Get(*current);
+
+			size_t subFolderCount = folder.subFolders.size();
+			probeEntries += weight * folder.entries;
+			probeFiles += weight * folder.files;
+			probeFolders += weight * subFolderCount;
+			probeBytes += weight * folder.bytes;
+
+			if (subFolderCount == 0) break;
+
+			weight *= subFolderCount;
+			current = &folder.subFolders[std::uniform_int_distribution<size_t>(0, subFolderCount - 1)(sampler.random)];
+		}
+
+		addSample(entries, probeEntries);
+		addSample(files, probeFiles);
+		addSample(folders, probeFolders);
+		addSample(bytes, probeBytes);
+
+		probesWithoutReads = sampler.foldersRead == foldersRead ? probesWithoutReads + 1 : 0;
+	}
+
+	// Random descents rarely reach the last few unread folders of a tree that fits in the budget,
+	// so those are read directly, which makes the counts exact if the budgets allow
+	if (sampler.unreadFolders > 0 && probesWithoutReads >= MAX_PROBES_WITHOUT_READS)
+	{
+		std::vector<const estimate_path_t *> pending;
+		pending.push_back(&root);
+		for (size_t i = 0; i < pending.size() &&
+			sampler.foldersRead < _folderBudget &&
+			std::chrono::steady_clock::now() < deadline; i++)
+		{
+			const sampled_folder_t &folder = sampler.Get(*pending[i]);
+			for (size_t j = 0; j < folder.subFolders.size(); j++)
+			{
+				pending.push_back(&folder.subFolders[j]);
+			}
+		}
+	}
+
+	// What was actually seen is a lower bound, and when nothing is left unread, the answer
+	double knownEntries = 0, knownFiles = 0, knownFolders = 0, knownBytes = 0, knownBytesVariance = 0;
+	bool knownBytesExact = true;
+	for (std::unordered_map<estimate_path_t, sampled_folder_t>::const_iterator it = sampler.folders.begin(); it != sampler.folders.end(); ++it)
+	{
+		knownEntries += it->second.entries;
+		knownFiles += it->second.files;
+		knownFolders += it->second.subFolders.size();
+		knownBytes += it->second.bytes;
+		knownBytesVariance += it->second.bytesVariance;
+		knownBytesExact &= it->second.bytesExact;
+	}
+
+	estimate.isExact = sampler.unreadFolders == 0;
+	estimate.isBytesExact = estimate.isExact && knownBytesExact;
+	if (estimate.isExact)
+	{
+		setEstimate(knownEntries, 0, entries, false, knownEntries, estimate.entries, estimate.entriesLow, estimate.entriesHigh);
+		setEstimate(knownFiles, 0, files, false, knownFiles, estimate.files, estimate.filesLow, estimate.filesHigh);
+		setEstimate(knownFolders, 0, folders, false, knownFolders, estimate.folders, estimate.foldersLow, estimate.foldersHigh);
+		setEstimate(knownBytes, knownBytesVariance, bytes, false, 0, estimate.bytes, estimate.bytesLow, estimate.bytesHigh);
+	}
+	else
+	{
+		setEstimate(0, 0, entries, true, knownEntries, estimate.entries, estimate.entriesLow, estimate.entriesHigh);
+		setEstimate(0, 0, files, true, knownFiles, estimate.files, estimate.filesLow, estimate.filesHigh);
+		setEstimate(0, 0, folders, true, knownFolders, estimate.folders, estimate.foldersLow, estimate.foldersHigh);
+		// Bytes are sampled within folders too, so what was seen is not a strict lower bound
+		setEstimate(0, 0, bytes, true, 0, estimate.bytes, estimate.bytesLow, estimate.bytesHigh);
+	}
+
+	estimate.probes = entries.count;
+	estimate.foldersRead = sampler.foldersRead;
+	estimate.elapsedMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+	return true;
+}
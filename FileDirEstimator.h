@@ -0,0 +1,104 @@
+//
+//  FileDirEstimator.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#pragma once
+
+#include <stdint.h>
+
+// An estimate of the size of a folder tree, excluding the root folder itself.
+// The low and high bounds are a nominal 95% confidence interval from the spread of the probes, never below what was
+// actually seen. The high bounds are infinite when fewer than two probes were made.
+// The interval is optimistic when the budget is small compared to an irregular tree: the probes rarely reach its few
+// heavy branches, so both the estimate and its spread come out low, and the exact count is then usually above the
+// high bound. tests/estimator_accuracy.cpp measured the entries interval covering the exact count in 46% of the runs
+// with a 200 folder budget and 64% with the default 1000 on a random deep tree (about 58-77% on /usr), and in all runs
+// on balanced trees and on trees that fit in the budget. Treat the high bounds as a hint rather than a limit.
+struct FileDirEstimate
+{
+	double entries, entriesLow, entriesHigh;
+	double files, filesLow, filesHigh;
+	double folders, foldersLow, foldersHigh;
+	double bytes, bytesLow, bytesHigh; // Of regular files
+
+	int probes; // Random descents that were made
+	int foldersRead; // Folders that were opened and read
+	bool isExact; // The whole tree was read, so the counts are exact
+	bool isBytesExact; // Also the size of every file was read, rather than of a sample (always with isExact on Windows)
+	double elapsedMilliseconds;
+};
+
+// Estimates the size of a folder tree in a bounded amount of time and I/O, without walking all of it,
+// e.g. to size the shards and timeouts of a full scan beforehand.
+// Uses Knuth's random descent: each probe walks down from the root choosing a sub folder uniformly at random,
+// and weighs the contents of each folder on the way by the product of the branching factors above it.
+// Every probe is an unbiased estimate of the totals, and the estimate is their mean. Folders already read are
+// remembered, so the upper levels are only read once. Bytes are estimated from a random sample of each folder's files.
+// Each folder is read by itself with a non-recursive BasicFileDirEnumerator, as the descents visit folders in a random order.
+// When the probes stop finding unread folders, the rest is read directly, so trees that fit in the budget are counted exactly.
+// Symbolic links are not followed. Trees with a few huge folders hidden deep under narrow ones have a high variance,
+// which the interval only partly shows, see FileDirEstimate.
+class FileDirEstimator
+{
+public:
+	FileDirEstimator(void);
+	virtual ~FileDirEstimator(void);
+
+	// The maximum number of folders to read. A probe in progress is completed, so this may be exceeded by its depth.
+	// Defaults to 1000.
+	void SetFolderBudget(int folderBudget);
+
+	// The time to spend, in milliseconds. A probe in progress is completed. Defaults to 50.
+	void SetTimeBudget(int milliseconds);
+
+	// How many files of each folder to read the size of, on POSIX. 0 to skip bytes. Defaults to 16.
+	// INT_MAX reads them all, so the bytes are exact whenever the whole tree is read.
+	void SetSizeSamplesPerFolder(int samples);
+
+	// Seeds the random descents, for repeatable estimates. Seeded randomly by default.
+	void SetSeed(uint64_t seed);
+
+	// Estimates the size of the tree under a folder. Returns false if the folder itself could not be read.
+#ifdef _WIN32 /* Wide char */
+	bool Estimate(const wchar_t *path, FileDirEstimate &estimate);
+#else /* UTF8 */
+	bool Estimate(const char *path, FileDirEstimate &estimate);
+#endif
+
+private:
+	struct Sampler;
+
+	int _folderBudget;
+	int _timeBudget;
+	int _sizeSamplesPerFolder;
+	uint64_t _seed;
+	bool _hasSeed;
+};
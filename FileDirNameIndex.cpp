@@ -0,0 +1,566 @@
+//
+//  FileDirNameIndex.cpp
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "FileDirNameIndex.h"
+#include "FileDirNameIndexTables.h"
+
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NAME_INDEX_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifndef FILEDIR_CHAR
+
+#ifdef _WIN32
+#define FILEDIR_CHAR wchar_t
+#define ustrlen wcslen
+#else
+#define FILEDIR_CHAR char
+#define ustrlen strlen
+#endif
+
+#endif
+
+#define IS_DOTS(name) (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+
+#define ASCII_LOWER(c) ((c) >= 'A' && (c) <= 'Z' ? (c) + ('a' - 'A') : (c))
+
+#define TABLE_SIZE(table) (sizeof(table) / sizeof(table[0]))
+
+// Hangul syllables are decomposed algorithmically, see section 3.12 of the Unicode standard
+#define HANGUL_S_BASE 0xAC00
+#define HANGUL_L_BASE 0x1100
+#define HANGUL_V_BASE 0x1161
+#define HANGUL_T_BASE 0x11A7
+#define HANGUL_T_COUNT 28
+#define HANGUL_N_COUNT (21 * HANGUL_T_COUNT)
+#define HANGUL_S_COUNT (19 * HANGUL_N_COUNT)
+
+// Bytes that are not valid UTF-8 are kept as lone surrogates, which valid UTF-8 can never decode to
+#define ESCAPED_BYTE_BASE 0xDC00
+
+static const unicode_mapping_t * findMapping(const unicode_mapping_t *table, size_t count, uint32_t codePoint)
+{
+	size_t low = 0, high = count;
+	while (low < high)
+	{
+		size_t middle = (low + high) / 2;
+		if (table[middle].codePoint < codePoint)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low < count && table[low].codePoint == codePoint ? &table[low] : NULL;
+}
+
+static int combiningClass(uint32_t codePoint)
+{
+	if (codePoint < s_combiningClasses[0].first) return 0; // Includes all of ASCII and Latin-1
+
+	size_t low = 0, high = TABLE_SIZE(s_combiningClasses);
+	while (low < high)
+	{
+		size_t middle = (low + high) / 2;
+		if (s_combiningClasses[middle].last < codePoint)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low < TABLE_SIZE(s_combiningClasses) && s_combiningClasses[low].first <= codePoint ? s_combiningClasses[low].combiningClass : 0;
+}
+
+// Decodes the code point starting at offset within a key, which is UTF-8 as written by appendUtf8()
+static uint32_t decodeKeyAt(const std::string &key, size_t offset)
+{
+	const unsigned char *s = (const unsigned char *)key.data() + offset;
+	if (s[0] < 0x80) return s[0];
+	if (s[0] < 0xE0) return ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+	if (s[0] < 0xF0) return ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+	return ((s[0] & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+}
+
+// Decodes the code point which ends at offset within a key, and moves offset to its start
+static uint32_t decodeKeyBefore(const std::string &key, size_t &offset)
+{
+	do offset--; while (offset > 0 && ((unsigned char)key[offset] & 0xC0) == 0x80);
+	return decodeKeyAt(key, offset);
+}
+
+#define IS_HANGUL_L(c) ((c) >= HANGUL_L_BASE && (c) < HANGUL_L_BASE + 19)
+#define IS_HANGUL_V(c) ((c) >= HANGUL_V_BASE && (c) < HANGUL_V_BASE + 21)
+#define IS_HANGUL_T(c) ((c) > HANGUL_T_BASE && (c) < HANGUL_T_BASE + HANGUL_T_COUNT)
+
+// Would NFC attach the code point to the key it follows? True for combining marks, and for the few starters that compose.
+static bool joinsKey(const std::string &key, uint32_t codePoint)
+{
+	if (codePoint < 0x0300 || key.empty()) return false;
+	if (combiningClass(codePoint)) return true;
+
+	size_t offset = key.size();
+	uint32_t previous = decodeKeyBefore(key, offset);
+
+	// Leading consonant + vowel, and a leading consonant + vowel syllable + trailing consonant
+	if (IS_HANGUL_V(codePoint)) return IS_HANGUL_L(previous);
+	if (IS_HANGUL_T(codePoint))
+	{
+		if (!IS_HANGUL_V(previous) || offset == 0) return false;
+		uint32_t beforePrevious = decodeKeyBefore(key, offset);
+		return IS_HANGUL_L(beforePrevious);
+	}
+
+	unicode_pair_t pair = { previous, codePoint };
+	return std::binary_search(s_composingPairs, s_composingPairs + TABLE_SIZE(s_composingPairs), pair,
+		[](const unicode_pair_t &x, const unicode_pair_t &y) { return x.first < y.first || (x.first == y.first && x.second < y.second); });
+}
+
+static void appendDecomposition(uint32_t codePoint, std::vector<uint32_t> &codePoints)
+{
+	if (codePoint - HANGUL_S_BASE < HANGUL_S_COUNT)
+	{
+		uint32_t index = codePoint - HANGUL_S_BASE;
+		codePoints.push_back(HANGUL_L_BASE + index / HANGUL_N_COUNT);
+		codePoints.push_back(HANGUL_V_BASE + (index % HANGUL_N_COUNT) / HANGUL_T_COUNT);
+		if (index % HANGUL_T_COUNT)
+		{
+			codePoints.push_back(HANGUL_T_BASE + index % HANGUL_T_COUNT);
+		}
+		return;
+	}
+
+	const unicode_mapping_t *mapping = codePoint < s_decompositions[0].codePoint ? NULL :
+		findMapping(s_decompositions, TABLE_SIZE(s_decompositions), codePoint);
+	if (mapping)
+	{
+		codePoints.insert(codePoints.end(), s_decompositionCodePoints + mapping->offset, s_decompositionCodePoints + mapping->offset + mapping->length);
+	}
+	else
+	{
+		codePoints.push_back(codePoint);
+	}
+}
+
+// Sorts each run of combining marks by their combining class, keeping the order of marks of the same class
+static void reorderCanonically(std::vector<uint32_t> &codePoints)
+{
+	for (size_t i = 1; i < codePoints.size(); i++)
+	{
+		uint32_t codePoint = codePoints[i];
+		int codePointClass = combiningClass(codePoint);
+		if (codePointClass == 0) continue;
+
+		size_t j = i;
+		while (j > 0 && combiningClass(codePoints[j - 1]) > codePointClass)
+		{
+			codePoints[j] = codePoints[j - 1];
+			j--;
+		}
+		codePoints[j] = codePoint;
+	}
+}
+
+// Encodes as UTF-8, surrogates included
+static void appendUtf8(uint32_t codePoint, std::string &out)
+{
+	if (codePoint < 0x80)
+	{
+		out.push_back((char)codePoint);
+	}
+	else if (codePoint < 0x800)
+	{
+		out.push_back((char)(0xC0 | (codePoint >> 6)));
+		out.push_back((char)(0x80 | (codePoint & 0x3F)));
+	}
+	else if (codePoint < 0x10000)
+	{
+		out.push_back((char)(0xE0 | (codePoint >> 12)));
+		out.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+		out.push_back((char)(0x80 | (codePoint & 0x3F)));
+	}
+	else
+	{
+		out.push_back((char)(0xF0 | (codePoint >> 18)));
+		out.push_back((char)(0x80 | ((codePoint >> 12) & 0x3F)));
+		out.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+		out.push_back((char)(0x80 | (codePoint & 0x3F)));
+	}
+}
+
+#ifdef _WIN32
+
+// Decodes UTF-16, keeping unpaired surrogates as they are
+static uint32_t decodeNext(const wchar_t *&p)
+{
+	uint32_t unit = (uint16_t)*p++;
+	if (unit >= 0xD800 && unit <= 0xDBFF && *p >= 0xDC00 && *p <= 0xDFFF)
+	{
+		uint32_t low = (uint16_t)*p++;
+		return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+	}
+	return unit;
+}
+
+// Appends the lower cased leading ASCII characters, and returns how many there were
+static size_t appendAsciiLower(const wchar_t *name, size_t length, std::string &key)
+{
+	size_t i = 0;
+	key.resize(length);
+	for (; i < length && name[i] < 0x80; i++)
+	{
+		key[i] = (char)ASCII_LOWER(name[i]);
+	}
+	key.resize(i);
+	return i;
+}
+
+#else
+
+// Decodes UTF-8, escaping every byte of an invalid, overlong or surrogate sequence
+static uint32_t decodeNext(const char *&p)
+{
+	const unsigned char *s = (const unsigned char *)p;
+	uint32_t lead = s[0];
+	if (lead < 0x80)
+	{
+		p++;
+		return lead;
+	}
+
+	int length = lead >= 0xF0 && lead <= 0xF4 ? 4 : lead >= 0xE0 ? (lead < 0xF0 ? 3 : 0) : lead >= 0xC2 ? 2 : 0;
+
+	uint32_t codePoint = 0;
+	bool valid = length > 0;
+	if (valid)
+	{
+		codePoint = lead & (0x3F >> (length - 1));
+		for (int i = 1; i < length && valid; i++)
+		{
+			valid = (s[i] & 0xC0) == 0x80;
+			codePoint = (codePoint << 6) | (s[i] & 0x3F);
+		}
+	}
+	if (valid)
+	{
+		valid = !(length == 3 && (codePoint < 0x800 || (codePoint >= 0xD800 && codePoint <= 0xDFFF))) &&
+			!(length == 4 && (codePoint < 0x10000 || codePoint > 0x10FFFF));
+	}
+
+	if (!valid)
+	{
+		p++;
+		return ESCAPED_BYTE_BASE + lead;
+	}
+
+	p += length;
+	return codePoint;
+}
+
+// Appends the lower cased leading ASCII characters, and returns how many there were
+static size_t appendAsciiLower(const char *name, size_t length, std::string &key)
+{
+	size_t i = 0;
+	key.resize(length);
+	char *out = &key[0];
+
+#ifdef NAME_INDEX_HAS_SSE2
+	const __m128i beforeA = _mm_set1_epi8('A' - 1);
+	const __m128i afterZ = _mm_set1_epi8('Z' + 1);
+	const __m128i caseBit = _mm_set1_epi8('a' - 'A');
+	for (; i + 16 <= length; i += 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(name + i));
+		if (_mm_movemask_epi8(chunk)) break; // Not ASCII, finish with the scalar loop below
+
+		__m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(chunk, beforeA), _mm_cmplt_epi8(chunk, afterZ));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(chunk, _mm_and_si128(isUpper, caseBit)));
+	}
+#endif
+
+	for (; i < length && !(name[i] & 0x80); i++)
+	{
+		out[i] = (char)ASCII_LOWER(name[i]);
+	}
+	key.resize(i);
+	return i;
+}
+
+#endif
+
+FileDirNameIndex::FileDirNameIndex(void)
+{
+	_isSorted = true;
+}
+
+FileDirNameIndex::~FileDirNameIndex(void)
+{
+}
+
+void FileDirNameIndex::GetKey(const FILEDIR_CHAR *name, std::string &key)
+{
+	size_t length = ustrlen(name);
+	size_t asciiLength = appendAsciiLower(name, length, key);
+	if (asciiLength == length) return;
+
+	// ASCII characters never combine with what follows them, so only the rest needs the full treatment:
+	// NFD, then full case folding, then NFD again, as case folding may produce decomposable or reordered characters.
+	std::vector<uint32_t> decomposed, folded;
+	decomposed.reserve(length - asciiLength + 8);
+	folded.reserve(length - asciiLength + 8);
+	for (const FILEDIR_CHAR *p = name + asciiLength, *end = name + length; p < end; )
+	{
+		appendDecomposition(decodeNext(p), decomposed);
+	}
+	reorderCanonically(decomposed);
+
+	for (size_t i = 0; i < decomposed.size(); i++)
+	{
+		uint32_t codePoint = decomposed[i];
+		if (codePoint < 0x80)
+		{
+			folded.push_back(ASCII_LOWER(codePoint));
+			continue;
+		}
+
+		const unicode_mapping_t *mapping = findMapping(s_caseFoldings, TABLE_SIZE(s_caseFoldings), codePoint);
+		if (!mapping)
+		{
+			folded.push_back(codePoint);
+			continue;
+		}
+
+		for (int j = 0; j < mapping->length; j++)
+		{
+			appendDecomposition(s_caseFoldingCodePoints[mapping->offset + j], folded);
+		}
+	}
+	reorderCanonically(folded);
+
+	for (size_t i = 0; i < folded.size(); i++)
+	{
+		appendUtf8(folded[i], key);
+	}
+}
+
+bool FileDirNameIndex::Build(const FILEDIR_CHAR *folderPath, int *errorCode/* = NULL*/)
+{
+	Clear();
+
+	if (errorCode) *errorCode = 0;
+
+#ifdef _WIN32
+	std::wstring pattern(folderPath);
+	if (!pattern.empty() && pattern[pattern.size() - 1] != '\\' && pattern[pattern.size() - 1] != '/')
+	{
+		pattern.push_back('\\');
+	}
+	pattern.push_back('*');
+
+	WIN32_FIND_DATAW data;
+	HANDLE handle = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		if (errorCode) *errorCode = (int)GetLastError();
+		return false;
+	}
+
+	do
+	{
+		if (IS_DOTS(data.cFileName)) continue;
+		Add(data.cFileName);
+	}
+	while (FindNextFileW(handle, &data));
+
+	DWORD error = GetLastError();
+	FindClose(handle);
+
+	if (error != ERROR_NO_MORE_FILES)
+	{
+		if (errorCode) *errorCode = (int)error;
+		return false;
+	}
+#else
+	DIR *dir = opendir(folderPath);
+	if (!dir)
+	{
+		if (errorCode) *errorCode = errno;
+		return false;
+	}
+
+	for (;;)
+	{
+		errno = 0;
+		dirent *entry = readdir(dir);
+		if (!entry)
+		{
+			if (errno)
+			{
+				if (errorCode) *errorCode = errno;
+				closedir(dir);
+				return false;
+			}
+			break;
+		}
+
+		if (IS_DOTS(entry->d_name)) continue;
+		Add(entry->d_name);
+	}
+
+	closedir(dir);
+#endif
+
+	return true;
+}
+
+void FileDirNameIndex::Add(const FILEDIR_CHAR *name)
+{
+	GetKey(name, _key);
+
+	Entry entry;
+	entry.nameOffset = (uint32_t)_names.size();
+	entry.next = -1;
+	_names.insert(_names.end(), name, name + ustrlen(name) + 1);
+
+	int32_t index = (int32_t)_entries.size();
+	_entries.push_back(entry);
+
+	Chain chain;
+	chain.first = chain.last = index;
+	std::pair<std::unordered_map<std::string, Chain>::iterator, bool> inserted = _keys.insert(std::make_pair(_key, chain));
+	if (inserted.second)
+	{
+		_isSorted = false;
+	}
+	else
+	{
+		_entries[inserted.first->second.last].next = index;
+		inserted.first->second.last = index;
+	}
+}
+
+void FileDirNameIndex::Clear()
+{
+	_names.clear();
+	_entries.clear();
+	_keys.clear();
+	_sortedKeys.clear();
+	_isSorted = true;
+}
+
+size_t FileDirNameIndex::Find(const FILEDIR_CHAR *name, std::vector<const FILEDIR_CHAR *> &matches) const
+{
+	std::string key;
+	GetKey(name, key);
+
+	std::unordered_map<std::string, Chain>::const_iterator it = _keys.find(key);
+	if (it == _keys.end()) return 0;
+
+	size_t count = 0;
+	for (int32_t i = it->second.first; i != -1; i = _entries[i].next)
+	{
+		matches.push_back(&_names[_entries[i].nameOffset]);
+		count++;
+	}
+	return count;
+}
+
+size_t FileDirNameIndex::FindPrefix(const FILEDIR_CHAR *prefix, std::vector<const FILEDIR_CHAR *> &matches)
+{
+	SortKeys();
+
+	std::string key;
+	GetKey(prefix, key);
+
+	size_t low = 0, high = _sortedKeys.size();
+	while (low < high)
+	{
+		size_t middle = (low + high) / 2;
+		if (_sortedKeys[middle]->first < key)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	size_t count = 0;
+	for (size_t k = low; k < _sortedKeys.size() && _sortedKeys[k]->first.compare(0, key.size(), key) == 0; k++)
+	{
+		// Keys are decomposed, so "e" is a prefix of the key of "\u00E9a". The match only counts where the name's
+		// composed form would start with the prefix too, i.e. when what follows can not join the prefix's last character.
+		const std::string &candidate = _sortedKeys[k]->first;
+		if (candidate.size() > key.size() && joinsKey(key, decodeKeyAt(candidate, key.size()))) continue;
+
+		for (int32_t i = _sortedKeys[k]->second.first; i != -1; i = _entries[i].next)
+		{
+			matches.push_back(&_names[_entries[i].nameOffset]);
+			count++;
+		}
+	}
+	return count;
+}
+
+void FileDirNameIndex::SortKeys()
+{
+	if (_isSorted) return;
+
+	_sortedKeys.clear();
+	_sortedKeys.reserve(_keys.size());
+	for (std::unordered_map<std::string, Chain>::const_iterator it = _keys.begin(); it != _keys.end(); ++it)
+	{
+		_sortedKeys.push_back(&*it);
+	}
+
+	std::sort(_sortedKeys.begin(), _sortedKeys.end(),
+		[](const std::pair<const std::string, Chain> *a, const std::pair<const std::string, Chain> *b) { return a->first < b->first; });
+
+	_isSorted = true;
+}
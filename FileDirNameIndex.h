@@ -0,0 +1,126 @@
+//
+//  FileDirNameIndex.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// An index of the names of a folder's entries, for case insensitive and normalization insensitive lookups.
+// Names are compared by key, which is the NFD of the full case folding of the NFD of the name, i.e. Unicode's
+// canonical caseless matching. So "Straße", "STRASSE" and "strasse" are the same name, and so are a precomposed
+// "é" and an "e" followed by a combining acute accent.
+// ASCII names, the vast majority, take a fast path that does not touch the Unicode tables.
+// Bytes that are not valid UTF-8 (or unpaired surrogates on Windows) are kept as is, so such names only match themselves.
+// Not thread safe.
+class FileDirNameIndex
+{
+public:
+	FileDirNameIndex(void);
+	virtual ~FileDirNameIndex(void);
+
+	// Indexes the names of a folder's entries, replacing the current contents.
+	// Returns false if the folder could not be read, and sets errorCode.
+#ifdef _WIN32 /* Wide char */
+	bool Build(const wchar_t *folderPath, int *errorCode = NULL);
+#else /* UTF8 */
+	bool Build(const char *folderPath, int *errorCode = NULL);
+#endif
+
+	// Adds a single name, i.e. FileDir::GetFileName() while enumerating a folder
+#ifdef _WIN32 /* Wide char */
+	void Add(const wchar_t *name);
+#else /* UTF8 */
+	void Add(const char *name);
+#endif
+
+	void Clear();
+
+	// The number of names in the index
+	inline size_t GetCount() const { return _entries.size(); }
+
+	// Appends the indexed names that match the name, in the order they were added. Returns how many were found.
+	// The returned names stay valid until the index is changed.
+#ifdef _WIN32 /* Wide char */
+	size_t Find(const wchar_t *name, std::vector<const wchar_t *> &matches) const;
+#else /* UTF8 */
+	size_t Find(const char *name, std::vector<const char *> &matches) const;
+#endif
+
+	// Appends the indexed names whose key starts with the key of the prefix, ordered by key. Returns how many were found.
+	// The match must end on a character of the composed (NFC) name: "e" does not match "\u00E9a", even though its key is a prefix.
+	// The returned names stay valid until the index is changed.
+#ifdef _WIN32 /* Wide char */
+	size_t FindPrefix(const wchar_t *prefix, std::vector<const wchar_t *> &matches);
+#else /* UTF8 */
+	size_t FindPrefix(const char *prefix, std::vector<const char *> &matches);
+#endif
+
+	// Computes the key that names are compared by, as UTF-8
+#ifdef _WIN32 /* Wide char */
+	static void GetKey(const wchar_t *name, std::string &key);
+#else /* UTF8 */
+	static void GetKey(const char *name, std::string &key);
+#endif
+
+private:
+	struct Entry
+	{
+		uint32_t nameOffset; // Into _names, null terminated
+		int32_t next; // The next entry with the same key, or -1
+	};
+
+	struct Chain
+	{
+		int32_t first;
+		int32_t last;
+	};
+
+	void SortKeys();
+
+#ifdef _WIN32 /* Wide char */
+	std::vector<wchar_t> _names;
+#else /* UTF8 */
+	std::vector<char> _names;
+#endif
+	std::vector<Entry> _entries;
+
+	// The entries of each key, and the keys in order for prefix lookups, sorted on demand
+	std::unordered_map<std::string, Chain> _keys;
+	std::vector<const std::pair<const std::string, Chain> *> _sortedKeys;
+	bool _isSorted;
+
+	// Reused by Add()
+	std::string _key;
+};
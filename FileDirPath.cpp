@@ -0,0 +1,275 @@
+//
+//  FileDirPath.cpp
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "FileDirPath.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PATH_HAS_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifndef FILEDIR_CHAR
+
+#ifdef _WIN32
+#define FILEDIR_CHAR wchar_t
+#else
+#define FILEDIR_CHAR char
+#endif
+
+#endif
+
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+#define IS_SEPARATOR(c) ((c) == '/' || (c) == '\\')
+
+#ifdef PATH_HAS_SSE2
+
+static inline int highestBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return (int)index;
+#else
+	return 31 - __builtin_clz(mask);
+#endif
+}
+
+#endif
+
+int FileDirPath::FindLastSeparator(const FILEDIR_CHAR *path, int length)
+{
+	int i = length;
+
+#ifdef PATH_HAS_SSE2
+	// Scans backwards a block at a time, comparing against both separators at once
+#ifdef _WIN32
+	const __m128i slash = _mm_set1_epi16('/');
+	const __m128i backslash = _mm_set1_epi16('\\');
+	for (; i >= 8; i -= 8)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(path + i - 8));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(chunk, slash), _mm_cmpeq_epi16(chunk, backslash)));
+		if (mask) return i - 8 + highestBit(mask) / 2;
+	}
+#else
+	const __m128i slash = _mm_set1_epi8('/');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	for (; i >= 16; i -= 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(path + i - 16));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, slash), _mm_cmpeq_epi8(chunk, backslash)));
+		if (mask) return i - 16 + highestBit(mask);
+	}
+#endif
+#endif
+
+	while (i > 0)
+	{
+		i--;
+		if (IS_SEPARATOR(path[i])) return i;
+	}
+	return -1;
+}
+
+int FileDirPath::GetFileNameOffset(const FILEDIR_CHAR *path, int length)
+{
+	int separator = FindLastSeparator(path, length);
+	if (separator > 0 && separator == length - 1)
+	{
+		separator = FindLastSeparator(path, separator);
+	}
+	return separator == -1 || length == 1 ? 0 : separator + 1;
+}
+
+int FileDirPath::GetExtensionOffset(const FILEDIR_CHAR *path, int length)
+{
+	// Only the last component is scanned, backwards, so the last period or separator found decides
+	int i = length;
+
+#ifdef PATH_HAS_SSE2
+	// A block at a time, without a branch per character, as extensions are short and of varying length
+#ifdef _WIN32
+	const __m128i period = _mm_set1_epi16('.');
+	const __m128i slash = _mm_set1_epi16('/');
+	const __m128i backslash = _mm_set1_epi16('\\');
+	for (; i >= 8; i -= 8)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(path + i - 8));
+		int periodMask = _mm_movemask_epi8(_mm_cmpeq_epi16(chunk, period));
+		int separatorMask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(chunk, slash), _mm_cmpeq_epi16(chunk, backslash)));
+		if (periodMask | separatorMask)
+		{
+			int last = highestBit(periodMask | separatorMask);
+			return periodMask & (1 << last) ? i - 8 + last / 2 + 1 : length;
+		}
+	}
+#else
+	const __m128i period = _mm_set1_epi8('.');
+	const __m128i slash = _mm_set1_epi8('/');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	for (; i >= 16; i -= 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(path + i - 16));
+		int periodMask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, period));
+		int separatorMask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, slash), _mm_cmpeq_epi8(chunk, backslash)));
+		if (periodMask | separatorMask)
+		{
+			int last = highestBit(periodMask | separatorMask);
+			return periodMask & (1 << last) ? i - 16 + last + 1 : length;
+		}
+	}
+#endif
+#endif
+
+	while (i > 0)
+	{
+		i--;
+		if (path[i] == '.') return i + 1;
+		if (IS_SEPARATOR(path[i])) break;
+	}
+	return length;
+}
+
+bool FileDirPath::NextComponent(const FILEDIR_CHAR *path, int length, int &offset, int &componentLength)
+{
+	while (offset < length && IS_SEPARATOR(path[offset])) offset++;
+	if (offset >= length) return false;
+
+	int end = offset;
+	while (end < length && !IS_SEPARATOR(path[end])) end++;
+	componentLength = end - offset;
+	return true;
+}
+
+int FileDirPath::Join(FILEDIR_CHAR *out, int capacity, const FILEDIR_CHAR *folder, int folderLength, const FILEDIR_CHAR *name, int nameLength)
+{
+	bool addSeparator = folderLength > 0 && !IS_SEPARATOR(folder[folderLength - 1]);
+	int length = folderLength + (addSeparator ? 1 : 0) + nameLength;
+
+	if (out && capacity > length)
+	{
+		memcpy(out, folder, sizeof(FILEDIR_CHAR) * folderLength);
+		if (addSeparator)
+		{
+			out[folderLength] = PATH_SEPARATOR;
+		}
+		memcpy(out + length - nameLength, name, sizeof(FILEDIR_CHAR) * nameLength);
+		out[length] = '\0';
+	}
+
+	return length;
+}
+
+int FileDirPath::Normalize(FILEDIR_CHAR *path, int length)
+{
+	if (length <= 0)
+	{
+		if (length == 0) path[0] = '\0';
+		return 0;
+	}
+
+	int read = 0, write = 0;
+	bool isAbsolute = false;
+
+#ifdef _WIN32
+	if (length >= 2 && path[1] == ':' && ((path[0] >= 'a' && path[0] <= 'z') || (path[0] >= 'A' && path[0] <= 'Z')))
+	{
+		// Drive letter
+		read = write = 2;
+	}
+	else if (length >= 3 && IS_SEPARATOR(path[0]) && IS_SEPARATOR(path[1]) && !IS_SEPARATOR(path[2]))
+	{
+		// UNC, the server and share follow as regular components
+		path[0] = path[1] = PATH_SEPARATOR;
+		read = write = 2;
+		isAbsolute = true;
+	}
+#endif
+
+	if (read < length && IS_SEPARATOR(path[read]))
+	{
+		path[write++] = PATH_SEPARATOR;
+		isAbsolute = true;
+	}
+
+	int rootLength = write;
+
+	for (int componentLength; NextComponent(path, length, read, componentLength); read += componentLength)
+	{
+		const FILEDIR_CHAR *component = path + read;
+
+		if (componentLength == 1 && component[0] == '.') continue;
+
+		if (componentLength == 2 && component[0] == '.' && component[1] == '.')
+		{
+			if (write > rootLength)
+			{
+				int lastStart = FindLastSeparator(path + rootLength, write - rootLength) + 1 + rootLength;
+				bool lastIsParent = write - lastStart == 2 && path[lastStart] == '.' && path[lastStart + 1] == '.';
+				if (!lastIsParent)
+				{
+					write = lastStart > rootLength ? lastStart - 1 : rootLength;
+					continue;
+				}
+			}
+			else if (isAbsolute)
+			{
+				continue;
+			}
+		}
+
+		if (write > rootLength)
+		{
+			path[write++] = PATH_SEPARATOR;
+		}
+		memmove(path + write, component, sizeof(FILEDIR_CHAR) * componentLength);
+		write += componentLength;
+	}
+
+	if (write == 0)
+	{
+		path[write++] = '.';
+	}
+	path[write] = '\0';
+
+	return write;
+}
@@ -0,0 +1,91 @@
+//
+//  FileDirPath.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#pragma once
+
+// Allocation free helpers for paths.
+// Both '/' and '\\' are separators on all platforms, as everywhere else in FileDir. Lengths are in characters,
+// and paths do not need to be null terminated.
+class FileDirPath
+{
+public:
+	// Returns the index of the last separator, or -1 if there is none
+#ifdef _WIN32 /* Wide char */
+	static int FindLastSeparator(const wchar_t *path, int length);
+#else
+	static int FindLastSeparator(const char *path, int length);
+#endif
+
+	// Returns where the last component starts, i.e. the file name.
+	// A trailing separator is part of the last component ("a/b/" gives "b/"), and a root is its own last component.
+#ifdef _WIN32 /* Wide char */
+	static int GetFileNameOffset(const wchar_t *path, int length);
+#else
+	static int GetFileNameOffset(const char *path, int length);
+#endif
+
+	// Returns where the extension of the last component starts (after the period), or length if it has none
+#ifdef _WIN32 /* Wide char */
+	static int GetExtensionOffset(const wchar_t *path, int length);
+#else
+	static int GetExtensionOffset(const char *path, int length);
+#endif
+
+	// Finds the next component of a path at or after offset, skipping separators, and sets offset to its start.
+	// Returns false when there are no more. Iterate with:
+	//   for (int offset = 0, componentLength; FileDirPath::NextComponent(path, length, offset, componentLength); offset += componentLength)
+#ifdef _WIN32 /* Wide char */
+	static bool NextComponent(const wchar_t *path, int length, int &offset, int &componentLength);
+#else
+	static bool NextComponent(const char *path, int length, int &offset, int &componentLength);
+#endif
+
+	// Joins a folder and a name, adding a separator unless the folder is empty or already ends with one.
+	// The result is null terminated, and only written if it fits in capacity (which includes the terminator).
+	// Returns the length of the result either way, so out can be NULL to measure.
+#ifdef _WIN32 /* Wide char */
+	static int Join(wchar_t *out, int capacity, const wchar_t *folder, int folderLength, const wchar_t *name, int nameLength);
+#else
+	static int Join(char *out, int capacity, const char *folder, int folderLength, const char *name, int nameLength);
+#endif
+
+	// Normalizes a path in place: collapses repeated separators, removes "." components, resolves ".." against the
+	// preceding component, and drops a trailing separator. Lexical only, symbolic links are not looked at.
+	// ".." components at the start of a relative path are kept, and ones that would go above the root are dropped.
+	// An empty relative result becomes ".". Returns the new length, and null terminates the path, so path must have
+	// room for length + 1 characters.
+#ifdef _WIN32 /* Wide char */
+	static int Normalize(wchar_t *path, int length);
+#else
+	static int Normalize(char *path, int length);
+#endif
+};
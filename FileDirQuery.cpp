@@ -0,0 +1,579 @@
+//
+//  FileDirQuery.cpp
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "FileDirQuery.h"
+#include "FileDir.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef FILEDIR_CHAR
+
+#ifdef _WIN32
+#define FILEDIR_CHAR wchar_t
+#define ustrlen wcslen
+#else
+#define FILEDIR_CHAR char
+#define ustrlen strlen
+#endif
+
+#endif
+
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+#ifdef __APPLE__
+#define STAT_MTIME_NSEC(st) ((int64_t)(st).st_mtimespec.tv_sec * 1000000000LL + (st).st_mtimespec.tv_nsec)
+#elif !defined(_WIN32)
+#define STAT_MTIME_NSEC(st) ((int64_t)(st).st_mtim.tv_sec * 1000000000LL + (st).st_mtim.tv_nsec)
+#endif
+
+#ifdef _WIN32
+#define FILETIME_TO_INT64(FILETIME) ((int64_t)(((__int64)FILETIME.dwLowDateTime) | (((__int64)FILETIME.dwHighDateTime) << 32)))
+#define FILETIME_TO_TIME_T(FILETIME) ((time_t)((FILETIME_TO_INT64(FILETIME) - 116444736000000000LL) / 10000000LL))
+#endif
+
+#define IS_DOTS(name) (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+
+#define ASCII_LOWER(c) ((c) >= 'A' && (c) <= 'Z' ? (c) + ('a' - 'A') : (c))
+
+typedef std::basic_string<FILEDIR_CHAR> query_path_t;
+
+// A ranked file. The path is only built once the file is known to enter a heap.
+typedef struct _candidate_t {
+	long long key;
+	long long size;
+	time_t creationTime;
+	time_t lastModificationTime;
+	time_t lastAccessTime;
+	time_t lastStatusChangeTime;
+	int nameOffset;
+	query_path_t path;
+} candidate_t;
+
+// Orders candidates best first. Heaps use this as their "less", so the worst candidate is on top.
+static bool isBetter(const candidate_t &a, const candidate_t &b)
+{
+	if (a.key != b.key) return a.key > b.key;
+	return a.path < b.path;
+}
+
+// Compares folder + name to a path, without building the joined string
+static int comparePath(const query_path_t &folder, const FILEDIR_CHAR *name, size_t nameLength, const query_path_t &path)
+{
+	int compare = path.compare(0, folder.size(), folder);
+	if (compare != 0) return -compare;
+	return -path.compare(folder.size(), query_path_t::npos, name, nameLength);
+}
+
+// Whether the name ends with a period and the (lower cased) extension
+static bool hasExtension(const FILEDIR_CHAR *name, size_t nameLength, const query_path_t &extension)
+{
+	if (nameLength < extension.size() + 1) return false;
+
+	const FILEDIR_CHAR *period = name + nameLength - extension.size() - 1;
+	if (*period != '.') return false;
+
+	for (size_t i = 0; i < extension.size(); i++)
+	{
+		if (ASCII_LOWER(period[1 + i]) != extension[i]) return false;
+	}
+	return true;
+}
+
+#ifndef _WIN32
+
+// The type of an entry as far as it is known without a stat()
+enum
+{
+	ENTRY_TYPE_UNKNOWN,
+	ENTRY_TYPE_FILE,
+	ENTRY_TYPE_FOLDER,
+	ENTRY_TYPE_OTHER,
+};
+
+static int entryType(const dirent *entry)
+{
+#ifdef DT_UNKNOWN
+	switch (entry->d_type)
+	{
+		case DT_REG: return ENTRY_TYPE_FILE;
+		case DT_DIR: return ENTRY_TYPE_FOLDER;
+		case DT_UNKNOWN: return ENTRY_TYPE_UNKNOWN;
+		default: return ENTRY_TYPE_OTHER;
+	}
+#else
+	(void)entry;
+	return ENTRY_TYPE_UNKNOWN;
+#endif
+}
+
+#endif
+
+// The state of a single Run(). Pending folders are shared by all the walking threads, each keeping its own heap.
+struct FileDirQuery::Walk
+{
+	Walk(FileDirQuery &owner) : query(owner), busy(0) { }
+
+	FileDirQuery &query;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<query_path_t> folders; // Pending folders, each with a trailing separator
+	int busy; // Threads currently reading a folder
+
+	std::vector<std::vector<candidate_t> > heaps; // One per thread
+
+	// Reads pending folders until there are none left and no other thread may add more
+	void Work(int worker)
+	{
+		std::vector<candidate_t> &heap = heaps[worker];
+		std::vector<query_path_t> found;
+		query_path_t folder;
+
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (folders.empty() && busy > 0)
+				{
+					condition.wait(lock);
+				}
+				if (folders.empty()) return;
+
+				folder.swap(folders.back());
+				folders.pop_back();
+				busy++;
+			}
+
+			Read(folder, heap, found);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (size_t i = 0; i < found.size(); i++)
+				{
+					folders.push_back(query_path_t());
+					folders.back().swap(found[i]);
+				}
+				busy--;
+				if (!found.empty() || busy == 0)
+				{
+					condition.notify_all();
+				}
+			}
+			found.clear();
+		}
+	}
+
+	// Whether a folder may contain files under the path prefix
+	bool MayContain(const query_path_t &folder) const
+	{
+		const query_path_t &prefix = query._pathPrefix;
+		return prefix.empty() ||
+			folder.compare(0, prefix.size(), prefix) == 0 ||
+			prefix.compare(0, folder.size(), folder) == 0;
+	}
+
+	// The predicates that only need the name, checked before reading the file's metadata
+	bool Matches(const query_path_t &folder, const FILEDIR_CHAR *name, size_t nameLength) const
+	{
+		if (!query._extension.empty() && !hasExtension(name, nameLength, query._extension)) return false;
+
+		const query_path_t &prefix = query._pathPrefix;
+		if (prefix.size() <= folder.size())
+		{
+			return prefix.empty() || folder.compare(0, prefix.size(), prefix) == 0;
+		}
+
+		size_t rest = prefix.size() - folder.size();
+		return folder.compare(0, folder.size(), prefix, 0, folder.size()) == 0 &&
+			nameLength >= rest && memcmp(name, prefix.data() + folder.size(), sizeof(FILEDIR_CHAR) * rest) == 0;
+	}
+
+	void Found(const query_path_t &folder, const FILEDIR_CHAR *name, size_t nameLength, std::vector<query_path_t> &found)
+	{
+		query_path_t subFolder;
+		subFolder.reserve(folder.size() + nameLength + 1);
+		subFolder.append(folder);
+		subFolder.append(name, nameLength);
+		subFolder.push_back(PATH_SEPARATOR);
+
+		if (MayContain(subFolder))
+		{
+			found.push_back(query_path_t());
+			found.back().swap(subFolder);
+		}
+	}
+
+	// Adds the file to the heap if it ranks high enough. The path is only built if it does.
+	void Offer(std::vector<candidate_t> &heap, candidate_t &candidate, const query_path_t &folder, const FILEDIR_CHAR *name, size_t nameLength)
+	{
+		size_t limit = (size_t)query._limit;
+		if (heap.size() >= limit)
+		{
+			const candidate_t &worst = heap.front();
+			if (candidate.key < worst.key) return;
+			if (candidate.key == worst.key && comparePath(folder, name, nameLength, worst.path) >= 0) return;
+		}
+
+		candidate.nameOffset = (int)folder.size();
+		candidate.path.assign(folder);
+		candidate.path.append(name, nameLength);
+
+		if (heap.size() >= limit)
+		{
+			// The evicted candidate's path buffer is reused for the next one
+			std::pop_heap(heap.begin(), heap.end(), isBetter);
+		}
+		else
+		{
+			heap.push_back(candidate_t());
+		}
+		std::swap(heap.back(), candidate);
+		std::push_heap(heap.begin(), heap.end(), isBetter);
+	}
+
+	void Failed(const query_path_t &folder, const FILEDIR_CHAR *name, int errorCode, FileDirErrorPhase phase)
+	{
+		if (!query._errorHandler) return;
+
+		if (name)
+		{
+			query_path_t path = folder + name;
+			query._errorHandler(path.c_str(), errorCode, phase, query._errorHandlerContext);
+		}
+		else
+		{
+			query._errorHandler(folder.c_str(), errorCode, phase, query._errorHandlerContext);
+		}
+	}
+
+	// Ranks the files of a single folder, and collects its sub folders. Returns false if the folder could not be opened.
+	bool Read(const query_path_t &folder, std::vector<candidate_t> &heap, std::vector<query_path_t> &found)
+	{
+		FileDirStats &stats = query._stats;
+		candidate_t candidate;
+
+#ifdef _WIN32
+		query_path_t pattern = folder + L"*";
+
+		uint64_t openBegin = stats.BeginPhase();
+		WIN32_FIND_DATAW data;
+		HANDLE handle = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+		stats.EndPhase(FileDirStatsPhaseOpen, openBegin);
+
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			Failed(folder, NULL, (int)GetLastError(), FileDirErrorPhaseOpen);
+			return false;
+		}
+		stats.DirectoryOpened();
+
+		do
+		{
+			if (IS_DOTS(data.cFileName)) continue;
+			stats.EntryRead();
+
+			DWORD attributes = data.dwFileAttributes;
+			if (attributes & (FILE_ATTRIBUTE_REPARSE_POINT | FILE_ATTRIBUTE_DEVICE)) continue;
+
+			size_t nameLength = wcslen(data.cFileName);
+
+			if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				Found(folder, data.cFileName, nameLength, found);
+				continue;
+			}
+
+			if (!Matches(folder, data.cFileName, nameLength)) continue;
+
+			candidate.size = ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+			candidate.key = query._order == FileDirQueryLargest ? candidate.size : FILETIME_TO_INT64(data.ftLastWriteTime);
+			candidate.creationTime = FILETIME_TO_TIME_T(data.ftCreationTime);
+			candidate.lastModificationTime = FILETIME_TO_TIME_T(data.ftLastWriteTime);
+			candidate.lastAccessTime = FILETIME_TO_TIME_T(data.ftLastAccessTime);
+			candidate.lastStatusChangeTime = -1;
+			Offer(heap, candidate, folder, data.cFileName, nameLength);
+		}
+		while (FindNextFileW(handle, &data));
+
+		DWORD error = GetLastError();
+		if (error != ERROR_NO_MORE_FILES)
+		{
+			Failed(folder, NULL, (int)error, FileDirErrorPhaseRead);
+		}
+
+		FindClose(handle);
+		stats.DirectoryClosed();
+#else
+		uint64_t openBegin = stats.BeginPhase();
+		DIR *dir = opendir(folder.c_str());
+		stats.EndPhase(FileDirStatsPhaseOpen, openBegin);
+
+		if (!dir)
+		{
+			Failed(folder, NULL, errno, FileDirErrorPhaseOpen);
+			return false;
+		}
+		stats.DirectoryOpened();
+
+		for (;;)
+		{
+			uint64_t readBegin = stats.BeginPhase();
+			errno = 0;
+			dirent *entry = readdir(dir);
+			stats.EndPhase(FileDirStatsPhaseRead, readBegin);
+
+			if (!entry)
+			{
+				if (errno)
+				{
+					Failed(folder, NULL, errno, FileDirErrorPhaseRead);
+				}
+				break;
+			}
+
+			if (IS_DOTS(entry->d_name)) continue;
+			stats.EntryRead();
+
+			int type = entryType(entry);
+			if (type == ENTRY_TYPE_OTHER) continue;
+
+			size_t nameLength = strlen(entry->d_name);
+
+			if (type == ENTRY_TYPE_FOLDER)
+			{
+				Found(folder, entry->d_name, nameLength, found);
+				continue;
+			}
+
+			// Files failing the name predicates are dropped without a stat()
+			bool matches = Matches(folder, entry->d_name, nameLength);
+			if (type == ENTRY_TYPE_FILE && !matches) continue;
+
+			uint64_t statBegin = stats.BeginPhase();
+			struct stat fileStat;
+			bool statSucceeded = fstatat(dirfd(dir), entry->d_name, &fileStat, AT_SYMLINK_NOFOLLOW) != -1;
+			int statError = statSucceeded ? 0 : errno;
+			stats.EndPhase(FileDirStatsPhaseStat, statBegin);
+			stats.StatIssued(statSucceeded);
+
+			if (!statSucceeded)
+			{
+				Failed(folder, entry->d_name, statError, FileDirErrorPhaseStat);
+				continue;
+			}
+
+			if (S_ISDIR(fileStat.st_mode))
+			{
+				Found(folder, entry->d_name, nameLength, found);
+				continue;
+			}
+
+			if (!S_ISREG(fileStat.st_mode) || !matches) continue;
+
+			candidate.size = (long long)fileStat.st_size;
+			candidate.key = query._order == FileDirQueryLargest ? candidate.size : STAT_MTIME_NSEC(fileStat);
+			candidate.creationTime = -1;
+			candidate.lastModificationTime = fileStat.st_mtime;
+			candidate.lastAccessTime = fileStat.st_atime;
+			candidate.lastStatusChangeTime = fileStat.st_ctime;
+			Offer(heap, candidate, folder, entry->d_name, nameLength);
+		}
+
+		closedir(dir);
+		stats.DirectoryClosed();
+#endif
+
+		return true;
+	}
+};
+
+FileDirQuery::FileDirQuery(void)
+{
+	_order = FileDirQueryLargest;
+	_limit = 100;
+	_threadCount = 0;
+	_errorHandler = NULL;
+	_errorHandlerContext = NULL;
+}
+
+FileDirQuery::~FileDirQuery(void)
+{
+}
+
+void FileDirQuery::SetOrder(FileDirQueryOrder order)
+{
+	_order = order;
+}
+
+void FileDirQuery::SetLimit(int limit)
+{
+	_limit = limit;
+}
+
+void FileDirQuery::SetExtension(const FILEDIR_CHAR *extension)
+{
+	_extension.clear();
+	if (!extension) return;
+
+	for (; *extension; extension++)
+	{
+		_extension.push_back(ASCII_LOWER(*extension));
+	}
+}
+
+void FileDirQuery::SetPathPrefix(const FILEDIR_CHAR *prefix)
+{
+	if (prefix)
+	{
+		_pathPrefix = prefix;
+	}
+	else
+	{
+		_pathPrefix.clear();
+	}
+}
+
+void FileDirQuery::SetThreadCount(int threadCount)
+{
+	_threadCount = threadCount;
+}
+
+void FileDirQuery::SetErrorHandler(FileDirErrorHandler handler, void *context/* = NULL*/)
+{
+	_errorHandler = handler;
+	_errorHandlerContext = context;
+}
+
+bool FileDirQuery::Run(const FILEDIR_CHAR *path, std::vector<FileDir *> &results)
+{
+	if (!path || path[0] == '\0') return false;
+
+	Walk walk(*this);
+
+	query_path_t root(path);
+	if (root[root.size() - 1] != '/' && root[root.size() - 1] != '\\')
+	{
+		root.push_back(PATH_SEPARATOR);
+	}
+
+	if (_limit <= 0 || !walk.MayContain(root)) return true;
+
+	int threadCount = _threadCount > 0 ? _threadCount : (int)std::thread::hardware_concurrency();
+	if (threadCount < 1) threadCount = 1;
+
+	walk.heaps.resize(threadCount);
+
+	// The root is read first, so a failure to open it is reported, and a flat folder does not start any threads
+	if (!walk.Read(root, walk.heaps[0], walk.folders)) return false;
+
+	if (!walk.folders.empty())
+	{
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+		{
+			threads.push_back(std::thread(&Walk::Work, &walk, i));
+		}
+
+		walk.Work(0);
+
+		for (size_t i = 0; i < threads.size(); i++)
+		{
+			threads[i].join();
+		}
+	}
+
+	// Merge the heaps
+	std::vector<candidate_t> &merged = walk.heaps[0];
+	for (int i = 1; i < threadCount; i++)
+	{
+		std::vector<candidate_t> &heap = walk.heaps[i];
+		for (size_t j = 0; j < heap.size(); j++)
+		{
+			merged.push_back(candidate_t());
+			std::swap(merged.back(), heap[j]);
+		}
+		std::vector<candidate_t>().swap(heap);
+	}
+
+	size_t count = std::min(merged.size(), (size_t)_limit);
+	std::partial_sort(merged.begin(), merged.begin() + count, merged.end(), isBetter);
+
+	results.reserve(results.size() + count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const candidate_t &candidate = merged[i];
+
+		FileDir *fileDir = new FileDir();
+		fileDir->Assign(candidate.path.c_str(), (int)candidate.path.size(), candidate.nameOffset);
+		_stats.Allocated(sizeof(FileDir) + sizeof(FILEDIR_CHAR) * fileDir->_fullPathCapacity);
+		fileDir->_isFile = true;
+		fileDir->_creationTime = candidate.creationTime;
+		fileDir->_lastModificationTime = candidate.lastModificationTime;
+		fileDir->_lastAccessTime = candidate.lastAccessTime;
+		fileDir->_lastStatusChangeTime = candidate.lastStatusChangeTime;
+		fileDir->_hasTimes = true;
+		fileDir->_size = candidate.size;
+		results.push_back(fileDir);
+	}
+
+	return true;
+}
+
+void FileDirQuery::GetStats(FileDirStatsSnapshot &snapshot) const
+{
+	_stats.Snapshot(snapshot);
+}
+
+void FileDirQuery::ResetStats()
+{
+	_stats.Reset();
+}
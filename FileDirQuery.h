@@ -0,0 +1,124 @@
+//
+//  FileDirQuery.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#pragma once
+
+#include "FileDirController.h"
+#include "FileDirStats.h"
+
+#include <string>
+#include <vector>
+
+class FileDir;
+
+// What a FileDirQuery ranks files by
+enum FileDirQueryOrder
+{
+	FileDirQueryLargest, // By size, largest first
+	FileDirQueryNewest, // By last modification time, most recent first
+};
+
+// Finds the top files of a folder tree, i.e. "the 100 largest files" or "the 1000 most recently modified files".
+// The tree is walked by several threads, each keeping only its best candidates in a heap bounded by the limit,
+// and the heaps are merged at the end. So memory is O(limit * threads) regardless of the size of the tree,
+// and a FileDir is only created for the final results.
+// Only regular files are ranked. Symbolic links (reparse points on Windows) are neither followed nor ranked,
+// so a file is never counted twice and link cycles are not a concern.
+// Ties are broken by path, so the results do not depend on the thread count.
+class FileDirQuery
+{
+public:
+	FileDirQuery(void);
+	virtual ~FileDirQuery(void);
+
+	void SetOrder(FileDirQueryOrder order);
+
+	// How many files to return. Defaults to 100.
+	void SetLimit(int limit);
+
+	// Only ranks files with this extension (without the period, compared ASCII case insensitive). NULL for any.
+#ifdef _WIN32 /* Wide char */
+	void SetExtension(const wchar_t *extension);
+#else
+	void SetExtension(const char *extension);
+#endif
+
+	// Only ranks files whose full path starts with this prefix. NULL for any.
+	// Folders that cannot contain such files are not read at all.
+	// The prefix is compared as is, so it should be spelled like the paths under the folder passed to Run().
+#ifdef _WIN32 /* Wide char */
+	void SetPathPrefix(const wchar_t *prefix);
+#else
+	void SetPathPrefix(const char *prefix);
+#endif
+
+	// How many threads walk the tree. 0 for one per hardware thread.
+	void SetThreadCount(int threadCount);
+
+	// Sets a handler for entries that could not be read. It is called from the walking threads, possibly concurrently.
+	void SetErrorHandler(FileDirErrorHandler handler, void *context = NULL);
+
+	// Runs the query over a folder and all of its sub folders.
+	// The results are appended to the vector best first, and should be deleted by the caller.
+	// Returns false if the folder itself could not be read.
+#ifdef _WIN32 /* Wide char */
+	bool Run(const wchar_t *path, std::vector<FileDir *> &results);
+#else
+	bool Run(const char *path, std::vector<FileDir *> &results);
+#endif
+
+	// Copies the counters collected so far. All zeros unless FILEDIR_ENABLE_STATS is defined.
+	void GetStats(FileDirStatsSnapshot &snapshot) const;
+
+	// Resets all counters
+	void ResetStats();
+
+private:
+	struct Walk;
+
+	FileDirQueryOrder _order;
+	int _limit;
+	int _threadCount;
+
+#ifdef _WIN32 /* Wide char */
+	std::wstring _extension;
+	std::wstring _pathPrefix;
+#else /* UTF8 */
+	std::string _extension;
+	std::string _pathPrefix;
+#endif
+
+	FileDirErrorHandler _errorHandler;
+	void *_errorHandlerContext;
+
+	FileDirStats _stats;
+};
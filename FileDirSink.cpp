@@ -0,0 +1,508 @@
+//
+//  FileDirSink.cpp
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "FileDirSink.h"
+#include "FileDirController.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#ifndef FILEDIR_CHAR
+
+#ifdef _WIN32
+#define FILEDIR_CHAR wchar_t
+#define ustrlen wcslen
+#else
+#define FILEDIR_CHAR char
+#define ustrlen strlen
+#endif
+
+#endif
+
+// Large enough for any record with paths up to a few thousand characters. Longer ones grow the buffers.
+#define MIN_BUFFER_SIZE (64 * 1024)
+
+// Worst case output bytes per path character: 3 bytes of UTF8 for each UTF16 unit on Windows, and 6 for a JSON \u escape
+#ifdef _WIN32
+#define MAX_BYTES_PER_PATH_CHAR 18
+#else
+#define MAX_BYTES_PER_PATH_CHAR 6
+#endif
+
+// Fixed part of a record: field names, numbers and separators
+#define MAX_RECORD_OVERHEAD 256
+
+// Pending chunks the writer thread may lag behind by
+#define MAX_PENDING_CHUNKS 2
+
+static const char hexDigits[] = "0123456789abcdef";
+
+// Returns the length of the valid UTF8 sequence starting at s, or 0 if the bytes there are not valid UTF8
+// (a stray continuation byte, a truncated or overlong sequence, a surrogate, or a code point above U+10FFFF)
+static int validUtf8Length(const unsigned char *s, size_t remaining)
+{
+	unsigned char lead = s[0];
+	int length;
+	unsigned char min = 0x80, max = 0xBF; // The valid range of the second byte
+
+	if (lead < 0x80) return 1;
+	else if (lead >= 0xC2 && lead <= 0xDF) length = 2;
+	else if (lead >= 0xE0 && lead <= 0xEF)
+	{
+		length = 3;
+		if (lead == 0xE0) min = 0xA0;
+		else if (lead == 0xED) max = 0x9F;
+	}
+	else if (lead >= 0xF0 && lead <= 0xF4)
+	{
+		length = 4;
+		if (lead == 0xF0) min = 0x90;
+		else if (lead == 0xF4) max = 0x8F;
+	}
+	else return 0;
+
+	if (remaining < (size_t)length) return 0;
+	if (s[1] < min || s[1] > max) return 0;
+	for (int i = 2; i < length; i++)
+	{
+		if ((s[i] & 0xC0) != 0x80) return 0;
+	}
+
+	return length;
+}
+
+FileDirSink::FileDirSink(FILE *output, FileDirSinkFormat format, bool useWriterThread/* = false*/, size_t bufferSize/* = 1 << 20*/)
+{
+	_output = output;
+	_format = format;
+	_failed = false;
+
+	_bufferSize = bufferSize < MIN_BUFFER_SIZE ? MIN_BUFFER_SIZE : bufferSize;
+	_buffer = new char[_bufferSize];
+	_length = 0;
+
+	_useWriterThread = useWriterThread;
+	_writerBusy = false;
+	_stopWriter = false;
+	if (_useWriterThread)
+	{
+		_writer = std::thread(&FileDirSink::WriterThread, this);
+	}
+
+	if (_format == FileDirSinkFormatCSV)
+	{
+		static const char header[] = "path,name,type,modified,accessed,statusChanged,created\n";
+		memcpy(_buffer, header, sizeof(header) - 1);
+		_length = sizeof(header) - 1;
+	}
+	else if (_format == FileDirSinkFormatBinary)
+	{
+		memcpy(_buffer, "FDB1", 4);
+		_length = 4;
+	}
+}
+
+FileDirSink::~FileDirSink(void)
+{
+	Flush();
+
+	if (_useWriterThread)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopWriter = true;
+		}
+		_condition.notify_all();
+		_writer.join();
+	}
+
+	delete [] _buffer;
+	for (size_t i = 0; i < _freeBuffers.size(); i++)
+	{
+		delete [] _freeBuffers[i];
+	}
+}
+
+bool FileDirSink::WriteChunk(const Chunk &chunk)
+{
+	if (fwrite(chunk.data, 1, chunk.length, _output) != chunk.length)
+	{
+		_failed = true;
+		return false;
+	}
+	return true;
+}
+
+void FileDirSink::WriterThread()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;)
+	{
+		_condition.wait(lock, [this] { return !_pendingChunks.empty() || _stopWriter; });
+		if (_pendingChunks.empty()) break;
+
+		Chunk chunk = _pendingChunks.front();
+		_pendingChunks.pop_front();
+		_writerBusy = true;
+
+		lock.unlock();
+		WriteChunk(chunk);
+		lock.lock();
+
+		_freeBuffers.push_back(chunk.data);
+		_writerBusy = false;
+		_condition.notify_all();
+	}
+}
+
+void FileDirSink::SubmitBuffer()
+{
+	if (_length == 0) return;
+
+	Chunk chunk;
+	chunk.data = _buffer;
+	chunk.length = _length;
+	_length = 0;
+
+	if (!_useWriterThread)
+	{
+		WriteChunk(chunk);
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condition.wait(lock, [this] { return _pendingChunks.size() < MAX_PENDING_CHUNKS; });
+
+		_pendingChunks.push_back(chunk);
+
+		if (_freeBuffers.empty())
+		{
+			_buffer = new char[_bufferSize];
+		}
+		else
+		{
+			_buffer = _freeBuffers.back();
+			_freeBuffers.pop_back();
+		}
+	}
+	_condition.notify_all();
+}
+
+bool FileDirSink::Flush()
+{
+	SubmitBuffer();
+
+	if (_useWriterThread)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condition.wait(lock, [this] { return _pendingChunks.empty() && !_writerBusy; });
+	}
+
+	if (fflush(_output) != 0)
+	{
+		_failed = true;
+	}
+
+	return !_failed;
+}
+
+void FileDirSink::Reserve(size_t length)
+{
+	if (_length + length <= _bufferSize) return;
+
+	SubmitBuffer();
+
+	if (length > _bufferSize)
+	{
+		// All buffers are idle after a flush, and all of them are too small
+		Flush();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (size_t i = 0; i < _freeBuffers.size(); i++)
+		{
+			delete [] _freeBuffers[i];
+		}
+		_freeBuffers.clear();
+
+		delete [] _buffer;
+		_bufferSize = length * 2;
+		_buffer = new char[_bufferSize];
+	}
+}
+
+void FileDirSink::AppendNumber(long long value)
+{
+	char digits[24];
+	int pos = sizeof(digits);
+
+	unsigned long long absolute = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+	do
+	{
+		digits[--pos] = (char)('0' + absolute % 10);
+		absolute /= 10;
+	}
+	while (absolute);
+
+	if (value < 0)
+	{
+		digits[--pos] = '-';
+	}
+
+	memcpy(_buffer + _length, digits + pos, sizeof(digits) - pos);
+	_length += sizeof(digits) - pos;
+}
+
+void FileDirSink::AppendTime(time_t value)
+{
+	if (value == -1)
+	{
+		if (_format == FileDirSinkFormatNDJSON)
+		{
+			memcpy(_buffer + _length, "null", 4);
+			_length += 4;
+		}
+		return;
+	}
+
+	AppendNumber((long long)value);
+}
+
+void FileDirSink::AppendPath(const FILEDIR_CHAR *path)
+{
+#ifdef _WIN32
+	int pathLength = (int)wcslen(path);
+	_utf8Path.resize(pathLength * 3 + 1);
+	int utf8Length = pathLength ? WideCharToMultiByte(CP_UTF8, 0, path, pathLength, &_utf8Path[0], (int)_utf8Path.size(), NULL, NULL) : 0;
+	const char *utf8 = &_utf8Path[0];
+	size_t length = (size_t)utf8Length;
+#else
+	const char *utf8 = path;
+	size_t length = strlen(path);
+#endif
+
+	char *out = _buffer + _length;
+
+	if (_format == FileDirSinkFormatNDJSON)
+	{
+		*out++ = '"';
+		for (size_t i = 0; i < length; i++)
+		{
+			unsigned char c = (unsigned char)utf8[i];
+			if (c >= 0x80)
+			{
+				int sequenceLength = validUtf8Length((const unsigned char *)utf8 + i, length - i);
+				if (sequenceLength)
+				{
+					memcpy(out, utf8 + i, sequenceLength);
+					out += sequenceLength;
+					i += sequenceLength - 1;
+				}
+				else
+				{
+					// Not UTF8 (POSIX names are arbitrary bytes), so the byte becomes U+FFFD to keep the line valid JSON
+					*out++ = (char)0xEF;
+					*out++ = (char)0xBF;
+					*out++ = (char)0xBD;
+				}
+			}
+			else if (c >= 0x20 && c != '"' && c != '\\')
+			{
+				*out++ = (char)c;
+			}
+			else if (c == '"' || c == '\\')
+			{
+				*out++ = '\\';
+				*out++ = (char)c;
+			}
+			else
+			{
+				*out++ = '\\';
+				*out++ = 'u';
+				*out++ = '0';
+				*out++ = '0';
+				*out++ = hexDigits[c >> 4];
+				*out++ = hexDigits[c & 0xF];
+			}
+		}
+		*out++ = '"';
+	}
+	else if (_format == FileDirSinkFormatCSV)
+	{
+		bool needsQuotes = false;
+		for (size_t i = 0; i < length && !needsQuotes; i++)
+		{
+			char c = utf8[i];
+			needsQuotes = c == ',' || c == '"' || c == '\n' || c == '\r';
+		}
+
+		if (needsQuotes)
+		{
+			*out++ = '"';
+			for (size_t i = 0; i < length; i++)
+			{
+				if (utf8[i] == '"')
+				{
+					*out++ = '"';
+				}
+				*out++ = utf8[i];
+			}
+			*out++ = '"';
+		}
+		else
+		{
+			memcpy(out, utf8, length);
+			out += length;
+		}
+	}
+	else
+	{
+		out[0] = (char)(length & 0xFF);
+		out[1] = (char)((length >> 8) & 0xFF);
+		out[2] = (char)((length >> 16) & 0xFF);
+		out[3] = (char)((length >> 24) & 0xFF);
+		memcpy(out + 4, utf8, length);
+		out += 4 + length;
+	}
+
+	_length = out - _buffer;
+}
+
+#define APPEND_LITERAL(literal) \
+	memcpy(_buffer + _length, literal, sizeof(literal) - 1); \
+	_length += sizeof(literal) - 1;
+
+static inline char *writeInt64LE(char *out, long long value)
+{
+	unsigned long long bits = (unsigned long long)value;
+	for (int i = 0; i < 8; i++)
+	{
+		out[i] = (char)((bits >> (i * 8)) & 0xFF);
+	}
+	return out + 8;
+}
+
+void FileDirSink::Write(FileDir *fileDir)
+{
+	if (!fileDir || !fileDir->GetFullPath()) return;
+
+	const FILEDIR_CHAR *fullPath = fileDir->GetFullPath();
+	const FILEDIR_CHAR *fileName = fileDir->GetFileName();
+	size_t fullPathLength = ustrlen(fullPath);
+	size_t fileNameLength = fileName ? ustrlen(fileName) : 0;
+
+	Reserve((fullPathLength + fileNameLength) * MAX_BYTES_PER_PATH_CHAR + MAX_RECORD_OVERHEAD);
+
+	if (_format == FileDirSinkFormatBinary)
+	{
+		size_t recordStart = _length;
+		_length += 4; // Record length, filled in below
+
+		_buffer[_length++] = (char)(fileDir->IsFolder() ? 2 : fileDir->IsFile() ? 1 : 0);
+
+		char *out = _buffer + _length;
+		out = writeInt64LE(out, (long long)fileDir->GetLastModified());
+		out = writeInt64LE(out, (long long)fileDir->GetLastAccessTime());
+		out = writeInt64LE(out, (long long)fileDir->GetLastStatusChangeTime());
+		out = writeInt64LE(out, (long long)fileDir->GetCreationTime());
+		_length = out - _buffer;
+
+		AppendPath(fullPath);
+
+		size_t recordLength = _length - recordStart - 4;
+		_buffer[recordStart] = (char)(recordLength & 0xFF);
+		_buffer[recordStart + 1] = (char)((recordLength >> 8) & 0xFF);
+		_buffer[recordStart + 2] = (char)((recordLength >> 16) & 0xFF);
+		_buffer[recordStart + 3] = (char)((recordLength >> 24) & 0xFF);
+		return;
+	}
+
+	const char *type = fileDir->IsFolder() ? "folder" : fileDir->IsFile() ? "file" : "other";
+	size_t typeLength = strlen(type);
+
+	if (_format == FileDirSinkFormatNDJSON)
+	{
+		APPEND_LITERAL("{\"path\":");
+		AppendPath(fullPath);
+		APPEND_LITERAL(",\"name\":");
+		AppendPath(fileName ? fileName : fullPath + fullPathLength);
+		APPEND_LITERAL(",\"type\":\"");
+		memcpy(_buffer + _length, type, typeLength);
+		_length += typeLength;
+		APPEND_LITERAL("\",\"modified\":");
+		AppendTime(fileDir->GetLastModified());
+		APPEND_LITERAL(",\"accessed\":");
+		AppendTime(fileDir->GetLastAccessTime());
+		APPEND_LITERAL(",\"statusChanged\":");
+		AppendTime(fileDir->GetLastStatusChangeTime());
+		APPEND_LITERAL(",\"created\":");
+		AppendTime(fileDir->GetCreationTime());
+		APPEND_LITERAL("}\n");
+	}
+	else
+	{
+		AppendPath(fullPath);
+		APPEND_LITERAL(",");
+		AppendPath(fileName ? fileName : fullPath + fullPathLength);
+		APPEND_LITERAL(",");
+		memcpy(_buffer + _length, type, typeLength);
+		_length += typeLength;
+		APPEND_LITERAL(",");
+		AppendTime(fileDir->GetLastModified());
+		APPEND_LITERAL(",");
+		AppendTime(fileDir->GetLastAccessTime());
+		APPEND_LITERAL(",");
+		AppendTime(fileDir->GetLastStatusChangeTime());
+		APPEND_LITERAL(",");
+		AppendTime(fileDir->GetCreationTime());
+		APPEND_LITERAL("\n");
+	}
+}
+
+long long FileDirSink::WriteAll(FileDirController &controller)
+{
+	long long count = 0;
+
+	FileDir fileDir;
+	while (controller.NextFile(fileDir))
+	{
+		Write(&fileDir);
+		count++;
+	}
+
+	return count;
+}
@@ -0,0 +1,128 @@
+//
+//  FileDirSink.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#pragma once
+
+#include "FileDir.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class FileDirController;
+
+enum FileDirSinkFormat
+{
+	// One JSON object per line:
+	// {"path":"/a/b.txt","name":"b.txt","type":"file","modified":1404000000,"accessed":...,"statusChanged":...,"created":null}
+	FileDirSinkFormatNDJSON,
+
+	// A header line, then one line per entry: path,name,type,modified,accessed,statusChanged,created
+	// Unknown times are left empty.
+	FileDirSinkFormatCSV,
+
+	// The magic "FDB1", then one record per entry, all integers little endian:
+	// uint32 record length (not including this field), uint8 type (0 = other, 1 = file, 2 = folder),
+	// int64 modified, int64 accessed, int64 statusChanged, int64 created (-1 when unknown),
+	// uint32 path length, path bytes (UTF8, not null terminated)
+	FileDirSinkFormatBinary,
+};
+
+// Formats entries into large reusable buffers, and writes them out in big chunks.
+// Paths are written as UTF8, also on Windows. POSIX names may be any bytes though: NDJSON replaces each byte
+// which is not part of a valid UTF8 sequence with U+FFFD, so every line stays valid JSON (but such a path can
+// not be opened from the output), while CSV and binary write the bytes as they are.
+class FileDirSink
+{
+public:
+	// When useWriterThread is set, full buffers are written by a background thread while formatting continues
+	FileDirSink(FILE *output, FileDirSinkFormat format, bool useWriterThread = false, size_t bufferSize = 1 << 20);
+	virtual ~FileDirSink(void);
+
+	// Formats a single entry
+	void Write(FileDir *fileDir);
+
+	// Writes every remaining entry of the controller, refilling a single FileDir. Returns the number of entries written.
+	long long WriteAll(FileDirController &controller);
+
+	// Writes out everything formatted so far. Returns false if any write has failed.
+	bool Flush();
+
+	// Did any write fail?
+	inline bool HasFailed() { return _failed; }
+
+private:
+	struct Chunk
+	{
+		char *data;
+		size_t length;
+	};
+
+	void Reserve(size_t length);
+	void SubmitBuffer();
+	bool WriteChunk(const Chunk &chunk);
+	void WriterThread();
+
+	void AppendNumber(long long value);
+	void AppendTime(time_t value);
+#ifdef _WIN32 /* Wide char */
+	void AppendPath(const wchar_t *path);
+#else /* UTF8 */
+	void AppendPath(const char *path);
+#endif
+
+	FILE *_output;
+	FileDirSinkFormat _format;
+	std::atomic<bool> _failed;
+
+	size_t _bufferSize;
+	char *_buffer;
+	size_t _length;
+
+	bool _useWriterThread;
+	std::thread _writer;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::deque<Chunk> _pendingChunks;
+	std::vector<char *> _freeBuffers;
+	bool _writerBusy;
+	bool _stopWriter;
+
+#ifdef _WIN32
+	std::vector<char> _utf8Path;
+#endif
+};
@@ -0,0 +1,206 @@
+//
+//  FileDirStats.cpp
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "FileDirStats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef FILEDIR_ENABLE_STATS
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#endif
+
+static const char * const phaseNames[FileDirStatsPhaseCount] = { "open", "read", "stat", "nextFile" };
+
+// Only the symbol of the library's own setting exists, see FileDirStats.h
+extern const int FILEDIR_STATS_LINK_CHECK = 1;
+
+FileDirStats::FileDirStats(void)
+{
+	Reset();
+}
+
+void FileDirStats::Reset()
+{
+#ifdef FILEDIR_ENABLE_STATS
+	_directoriesOpened = 0;
+	_entriesRead = 0;
+	_statsIssued = 0;
+	_statsFailed = 0;
+	_bytesAllocated = 0;
+	_openHandles = 0;
+	_maxOpenHandles = 0;
+	_maxStackDepth = 0;
+
+	for (int phase = 0; phase < FileDirStatsPhaseCount; phase++)
+	{
+		_latencyCount[phase] = 0;
+		_latencyTotalNs[phase] = 0;
+		for (int bucket = 0; bucket < FILEDIR_STATS_HISTOGRAM_BUCKETS; bucket++)
+		{
+			_latencyHistogram[phase][bucket] = 0;
+		}
+	}
+#endif
+}
+
+void FileDirStats::Snapshot(FileDirStatsSnapshot &snapshot) const
+{
+	memset(&snapshot, 0, sizeof(snapshot));
+
+#ifdef FILEDIR_ENABLE_STATS
+	snapshot.directoriesOpened = _directoriesOpened.load(std::memory_order_relaxed);
+	snapshot.entriesRead = _entriesRead.load(std::memory_order_relaxed);
+	snapshot.statsIssued = _statsIssued.load(std::memory_order_relaxed);
+	snapshot.statsFailed = _statsFailed.load(std::memory_order_relaxed);
+	snapshot.bytesAllocated = _bytesAllocated.load(std::memory_order_relaxed);
+	snapshot.openHandles = _openHandles.load(std::memory_order_relaxed);
+	snapshot.maxOpenHandles = _maxOpenHandles.load(std::memory_order_relaxed);
+	snapshot.maxStackDepth = _maxStackDepth.load(std::memory_order_relaxed);
+
+	for (int phase = 0; phase < FileDirStatsPhaseCount; phase++)
+	{
+		snapshot.latencyCount[phase] = _latencyCount[phase].load(std::memory_order_relaxed);
+		snapshot.latencyTotalNs[phase] = _latencyTotalNs[phase].load(std::memory_order_relaxed);
+		for (int bucket = 0; bucket < FILEDIR_STATS_HISTOGRAM_BUCKETS; bucket++)
+		{
+			snapshot.latencyHistogram[phase][bucket] = _latencyHistogram[phase][bucket].load(std::memory_order_relaxed);
+		}
+	}
+#endif
+}
+
+#ifdef FILEDIR_ENABLE_STATS
+
+uint64_t FileDirStats::Now()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)((double)counter.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void FileDirStats::RecordLatency(FileDirStatsPhase phase, uint64_t ns)
+{
+	int bucket = 0;
+	if (ns > 1)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		bucket = 63 - __builtin_clzll(ns);
+#else
+		for (uint64_t value = ns; value > 1; value >>= 1) bucket++;
+#endif
+	}
+	if (bucket >= FILEDIR_STATS_HISTOGRAM_BUCKETS)
+	{
+		bucket = FILEDIR_STATS_HISTOGRAM_BUCKETS - 1;
+	}
+
+	_latencyCount[phase].fetch_add(1, std::memory_order_relaxed);
+	_latencyTotalNs[phase].fetch_add(ns, std::memory_order_relaxed);
+	_latencyHistogram[phase][bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+#endif
+
+// Appends a decimal number. A uint64_t has at most 20 digits.
+static void AppendNumber(std::string &json, uint64_t value)
+{
+	char buffer[24];
+	int length = snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)value);
+	if (length > 0 && length < (int)sizeof(buffer))
+	{
+		json.append(buffer, length);
+	}
+}
+
+std::string FileDirStatsSnapshot::ToJSON() const
+{
+	std::string json;
+	json.reserve(2048);
+
+	// The names and numbers are appended separately, so no field can be cut short
+#define APPEND_FIELD(name) \
+	json += "\"" #name "\":"; \
+	AppendNumber(json, name); \
+	json += ',';
+
+	json += '{';
+	APPEND_FIELD(directoriesOpened);
+	APPEND_FIELD(entriesRead);
+	APPEND_FIELD(statsIssued);
+	APPEND_FIELD(statsFailed);
+	APPEND_FIELD(bytesAllocated);
+	APPEND_FIELD(openHandles);
+	APPEND_FIELD(maxOpenHandles);
+	APPEND_FIELD(maxStackDepth);
+
+#undef APPEND_FIELD
+
+	json += "\"latency\":{";
+	for (int phase = 0; phase < FileDirStatsPhaseCount; phase++)
+	{
+		if (phase) json += ',';
+		json += '"';
+		json += phaseNames[phase];
+		json += "\":{\"count\":";
+		AppendNumber(json, latencyCount[phase]);
+		json += ",\"totalNs\":";
+		AppendNumber(json, latencyTotalNs[phase]);
+		json += ",\"histogram\":[";
+
+		for (int bucket = 0; bucket < FILEDIR_STATS_HISTOGRAM_BUCKETS; bucket++)
+		{
+			if (bucket) json += ',';
+			AppendNumber(json, latencyHistogram[phase][bucket]);
+		}
+		json += "]}";
+	}
+	json += "}}";
+
+	return json;
+}
@@ -0,0 +1,215 @@
+//
+//  FileDirStats.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#ifdef FILEDIR_ENABLE_STATS
+#include <atomic>
+#endif
+
+// Define FILEDIR_ENABLE_STATS to collect statistics in FileDirController.
+// When it is not defined, all of the FileDirStats methods are empty inlines and compile away, and so do the counters.
+// This changes the layout of every class holding a FileDirStats, so the define must be the same in every translation
+// unit, the library's and its callers'. A mismatch fails to link, on an undefined FileDirStatsLinkCheck... symbol.
+#ifdef FILEDIR_ENABLE_STATS
+#define FILEDIR_STATS_LINK_CHECK FileDirStatsLinkCheckEnabled
+#else
+#define FILEDIR_STATS_LINK_CHECK FileDirStatsLinkCheckDisabled
+#endif
+
+// Defined only in FileDirStats.cpp, for its own setting, and referenced by every translation unit including this header
+extern const int FILEDIR_STATS_LINK_CHECK;
+#if defined(_MSC_VER)
+#ifdef FILEDIR_ENABLE_STATS
+#pragma detect_mismatch("FILEDIR_ENABLE_STATS", "1")
+#else
+#pragma detect_mismatch("FILEDIR_ENABLE_STATS", "0")
+#endif
+#elif defined(__GNUC__) || defined(__clang__)
+static const int * const s_fileDirStatsLinkCheck __attribute__((used)) = &FILEDIR_STATS_LINK_CHECK;
+#endif
+
+enum FileDirStatsPhase
+{
+	FileDirStatsPhaseOpen = 0, // Opening a folder (opendir / FindFirstFile)
+	FileDirStatsPhaseRead, // Reading the next entry (readdir / FindNextFile)
+	FileDirStatsPhaseStat, // Reading an entry's metadata (stat)
+	FileDirStatsPhaseNextFile, // A whole NextFile() call, as seen by the caller
+	FileDirStatsPhaseCount
+};
+
+// Bucket N counts calls that took [2^N, 2^(N+1)) nanoseconds. The last bucket takes everything above.
+#define FILEDIR_STATS_HISTOGRAM_BUCKETS 32
+
+// A plain copy of the statistics, taken at a single point in time
+struct FileDirStatsSnapshot
+{
+	uint64_t directoriesOpened;
+	uint64_t entriesRead;
+	uint64_t statsIssued;
+	uint64_t statsFailed;
+	uint64_t bytesAllocated;
+	uint64_t openHandles;
+	uint64_t maxOpenHandles;
+	uint64_t maxStackDepth;
+
+	uint64_t latencyCount[FileDirStatsPhaseCount];
+	uint64_t latencyTotalNs[FileDirStatsPhaseCount];
+	uint64_t latencyHistogram[FileDirStatsPhaseCount][FILEDIR_STATS_HISTOGRAM_BUCKETS];
+
+	// Returns the snapshot as a single line JSON object
+	std::string ToJSON() const;
+};
+
+class FileDirStats
+{
+public:
+	FileDirStats(void);
+
+	// Are statistics compiled in?
+	static inline bool IsEnabled()
+	{
+#ifdef FILEDIR_ENABLE_STATS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// Copies the current values. Safe to call from another thread while a scan is running.
+	void Snapshot(FileDirStatsSnapshot &snapshot) const;
+
+	// Zeroes all values
+	void Reset();
+
+	// Returns a timestamp to be passed later to EndPhase()
+	static inline uint64_t BeginPhase()
+	{
+#ifdef FILEDIR_ENABLE_STATS
+		return Now();
+#else
+		return 0;
+#endif
+	}
+
+	inline void EndPhase(FileDirStatsPhase phase, uint64_t begin)
+	{
+#ifdef FILEDIR_ENABLE_STATS
+		RecordLatency(phase, Now() - begin);
+#else
+		(void)phase; (void)begin;
+#endif
+	}
+
+	inline void DirectoryOpened()
+	{
+#ifdef FILEDIR_ENABLE_STATS
+		_directoriesOpened.fetch_add(1, std::memory_order_relaxed);
+		uint64_t handles = _openHandles.fetch_add(1, std::memory_order_relaxed) + 1;
+		UpdateMax(_maxOpenHandles, handles);
+#endif
+	}
+
+	inline void DirectoryClosed()
+	{
+#ifdef FILEDIR_ENABLE_STATS
+		_openHandles.fetch_sub(1, std::memory_order_relaxed);
+#endif
+	}
+
+	inline void EntryRead()
+	{
+#ifdef FILEDIR_ENABLE_STATS
+		_entriesRead.fetch_add(1, std::memory_order_relaxed);
+#endif
+	}
+
+	inline void StatIssued(bool success)
+	{
+#ifdef FILEDIR_ENABLE_STATS
+		_statsIssued.fetch_add(1, std::memory_order_relaxed);
+		if (!success)
+		{
+			_statsFailed.fetch_add(1, std::memory_order_relaxed);
+		}
+#else
+		(void)success;
+#endif
+	}
+
+	inline void Allocated(size_t bytes)
+	{
+#ifdef FILEDIR_ENABLE_STATS
+		_bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+#else
+		(void)bytes;
+#endif
+	}
+
+	inline void StackDepth(size_t depth)
+	{
+#ifdef FILEDIR_ENABLE_STATS
+		UpdateMax(_maxStackDepth, depth);
+#else
+		(void)depth;
+#endif
+	}
+
+private:
+
+#ifdef FILEDIR_ENABLE_STATS
+	static uint64_t Now();
+	void RecordLatency(FileDirStatsPhase phase, uint64_t ns);
+
+	static inline void UpdateMax(std::atomic<uint64_t> &max, uint64_t value)
+	{
+		uint64_t current = max.load(std::memory_order_relaxed);
+		while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed));
+	}
+
+	std::atomic<uint64_t> _directoriesOpened;
+	std::atomic<uint64_t> _entriesRead;
+	std::atomic<uint64_t> _statsIssued;
+	std::atomic<uint64_t> _statsFailed;
+	std::atomic<uint64_t> _bytesAllocated;
+	std::atomic<uint64_t> _openHandles;
+	std::atomic<uint64_t> _maxOpenHandles;
+	std::atomic<uint64_t> _maxStackDepth;
+
+	std::atomic<uint64_t> _latencyCount[FileDirStatsPhaseCount];
+	std::atomic<uint64_t> _latencyTotalNs[FileDirStatsPhaseCount];
+	std::atomic<uint64_t> _latencyHistogram[FileDirStatsPhaseCount][FILEDIR_STATS_HISTOGRAM_BUCKETS];
+#endif
+};
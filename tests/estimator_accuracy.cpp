@@ -0,0 +1,266 @@
+//
+//  estimator_accuracy.cpp
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+
+// Accuracy harness for FileDirEstimator: builds synthetic trees, counts them exactly with a full FileDirController
+// walk, and compares the estimates of many seeds against that.
+//
+// Build from the repository root (C++17, for std::filesystem), then run with an optional scratch folder:
+//   g++ -O2 -std=c++17 -I. tests/estimator_accuracy.cpp FileDirEstimator.cpp FileDirController.cpp FileDirCache.cpp FileDirStats.cpp FileDirPath.cpp FileDir.cpp -o estimator_accuracy -lpthread
+//   ./estimator_accuracy [scratch folder]
+//
+// The trees are created under the scratch folder (default: estimator_accuracy_trees in the current folder) and reused
+// by later runs. The seeds are fixed, so the results are repeatable. Exits non-zero when a check fails: an estimate
+// which claims to be exact (or to have exact bytes) but is not, or a median error or an interval coverage worse than the tree's limits below,
+// which are what FileDirEstimator.h documents.
+
+#include "FileDirEstimator.h"
+#include "FileDirController.h"
+#include "FileDir.h"
+
+#include <stdio.h>
+#include <limits.h>
+#include <math.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#define SEEDS 50
+
+struct ExactCounts
+{
+	double entries, files, folders, bytes;
+};
+
+static void makeFolder(const fs::path &path, int files, const std::function<long long()> &size)
+{
+	fs::create_directories(path);
+	for (int i = 0; i < files; i++)
+	{
+		fs::path file = path / ("f" + std::to_string(i));
+		std::ofstream(file.string()).close();
+		fs::resize_file(file, (uintmax_t)size());
+	}
+}
+
+// 6-way folders 4 levels deep, 20 files of 1000 bytes each
+static void makeBalanced(const fs::path &path, int depth)
+{
+	makeFolder(path, 20, []() { return 1000LL; });
+	if (depth == 0) return;
+	for (int i = 0; i < 6; i++)
+	{
+		makeBalanced(path / ("d" + std::to_string(i)), depth - 1);
+	}
+}
+
+// 3000 folders, each attached to a random earlier one (half of the time a recent one, making deep chains),
+// with an exponentially distributed number of files of random sizes
+static void makeRandom(const fs::path &path)
+{
+	std::mt19937_64 random(7);
+	std::uniform_int_distribution<long long> size(0, 100000);
+	std::exponential_distribution<double> fileCount(1.0 / 10);
+	std::function<long long()> randomSize = [&]() { return size(random); };
+
+	std::vector<fs::path> folders;
+	folders.push_back(path);
+	makeFolder(path, 5, randomSize);
+	for (int i = 0; i < 3000; i++)
+	{
+		size_t first = std::uniform_int_distribution<int>(0, 1)(random) && folders.size() > 200 ? folders.size() - 200 : 0;
+		const fs::path parent = folders[std::uniform_int_distribution<size_t>(first, folders.size() - 1)(random)];
+		folders.push_back(parent / ("d" + std::to_string(i)));
+		makeFolder(folders.back(), std::min((int)fileCount(random), 200), randomSize);
+	}
+}
+
+// 50 small shallow folders, and a narrow chain 6 deep under one of them leading to a folder of 20000 files:
+// the hard case for random descents
+static void makeSkewed(const fs::path &path)
+{
+	for (int i = 0; i < 50; i++)
+	{
+		makeFolder(path / ("top" + std::to_string(i)), 10, []() { return 100LL; });
+	}
+	fs::path chain = path / "top0";
+	for (int i = 0; i < 6; i++)
+	{
+		chain /= "chain" + std::to_string(i);
+	}
+	makeFolder(chain, 20000, []() { return 0LL; });
+}
+
+static ExactCounts countExactly(const fs::path &path)
+{
+	ExactCounts exact = { 0, 0, 0, 0 };
+
+	FileDirController controller;
+	controller.EnumerateFilesAtPath(path.string().c_str(), true);
+	FileDir fileDir;
+	while (controller.NextFile(fileDir))
+	{
+		exact.entries++;
+		if (fileDir.IsFolder()) exact.folders++;
+		if (fileDir.IsFile())
+		{
+			exact.files++;
+			exact.bytes += (double)fileDir.GetSize();
+		}
+	}
+	return exact;
+}
+
+static double median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+// Runs SEEDS estimates with a folder budget, prints a line of results, and returns false if a check failed.
+// With requireBytesExact, every run that is exact must have read the size of every file too.
+static bool check(const char *name, const fs::path &path, const ExactCounts &exact, int folderBudget, int sizeSamples, double maxMedianError, int minCoverage, bool requireBytesExact = false)
+{
+	std::vector<double> errors, bytesErrors;
+	int covered = 0, bytesCovered = 0, exactRuns = 0;
+	double reads = 0, milliseconds = 0;
+	bool failed = false;
+
+	for (int seed = 1; seed <= SEEDS; seed++)
+	{
+		FileDirEstimator estimator;
+		estimator.SetFolderBudget(folderBudget);
+		estimator.SetTimeBudget(10000); // Only the folder budget should matter, even on a slow machine
+		estimator.SetSizeSamplesPerFolder(sizeSamples);
+		estimator.SetSeed((uint64_t)seed);
+
+		FileDirEstimate estimate;
+		if (!estimator.Estimate(path.string().c_str(), estimate))
+		{
+			printf("%s: Estimate() failed\n", name);
+			return false;
+		}
+
+		errors.push_back(fabs(estimate.entries - exact.entries) / exact.entries);
+		bytesErrors.push_back(fabs(estimate.bytes - exact.bytes) / exact.bytes);
+		covered += estimate.entriesLow <= exact.entries && exact.entries <= estimate.entriesHigh;
+		bytesCovered += estimate.bytesLow <= exact.bytes && exact.bytes <= estimate.bytesHigh;
+		reads += estimate.foldersRead;
+		milliseconds += estimate.elapsedMilliseconds;
+
+		if (estimate.isExact)
+		{
+			exactRuns++;
+			if (estimate.entries != exact.entries || estimate.files != exact.files || estimate.folders != exact.folders)
+			{
+				printf("%s: seed %d claims to be exact, but counted %.0f entries, %.0f files, %.0f folders\n",
+					name, seed, estimate.entries, estimate.files, estimate.folders);
+				failed = true;
+			}
+			if (requireBytesExact && !estimate.isBytesExact)
+			{
+				printf("%s: seed %d is exact, but its bytes are not\n", name, seed);
+				failed = true;
+			}
+		}
+		if (estimate.isBytesExact && estimate.bytes != exact.bytes)
+		{
+			printf("%s: seed %d claims exact bytes, but counted %.0f bytes\n", name, seed, estimate.bytes);
+			failed = true;
+		}
+	}
+
+	int coverage = 100 * covered / SEEDS;
+	double medianError = median(errors);
+	printf("%-9s %8.0f %7d %9.1f%% %8d%% %9.1f%% %8d%% %7.0f %7.1f %6d\n",
+		name, exact.entries, folderBudget, 100 * medianError, coverage, 100 * median(bytesErrors), 100 * bytesCovered / SEEDS,
+		reads / SEEDS, milliseconds / SEEDS, exactRuns);
+
+	if (medianError > maxMedianError)
+	{
+		printf("%s: the median error of the entries is above %.0f%%\n", name, 100 * maxMedianError);
+		failed = true;
+	}
+	if (coverage < minCoverage)
+	{
+		printf("%s: the interval of the entries covers the exact count in less than %d%% of the runs\n", name, minCoverage);
+		failed = true;
+	}
+	return !failed;
+}
+
+int main(int argc, char **argv)
+{
+	fs::path scratch = argc > 1 ? fs::path(argv[1]) : fs::path("estimator_accuracy_trees");
+
+	// The limits of the median error and of the coverage, for the budgets of 200 and 1000 folders
+	struct Tree
+	{
+		const char *name;
+		std::function<void(const fs::path &)> make;
+		double maxMedianError200, maxMedianError1000;
+		int minCoverage200, minCoverage1000;
+	} trees[] = {
+		{ "balanced", [](const fs::path &path) { makeBalanced(path, 4); }, 0.05, 0.05, 95, 95 },
+		{ "random", makeRandom, 0.7, 0.5, 40, 55 },
+		{ "skewed", makeSkewed, 0.05, 0.05, 95, 95 },
+	};
+
+	bool succeeded = true;
+	printf("%-9s %8s %7s %10s %9s %10s %9s %7s %7s %6s\n",
+		"tree", "entries", "budget", "median err", "covered", "bytes err", "covered", "reads", "ms", "exact");
+
+	for (const Tree &tree : trees)
+	{
+		fs::path path = scratch / tree.name;
+		if (!fs::exists(path))
+		{
+			tree.make(path);
+		}
+		ExactCounts exact = countExactly(path);
+
+		// A small budget, the default one, and one that fits the whole tree, which must come back exact.
+		// The last is repeated reading every file's size, which must make the bytes exact too.
+		succeeded &= check(tree.name, path, exact, 200, 16, tree.maxMedianError200, tree.minCoverage200);
+		succeeded &= check(tree.name, path, exact, 1000, 16, tree.maxMedianError1000, tree.minCoverage1000);
+		succeeded &= check(tree.name, path, exact, 1000000, 16, 0, 100);
+		succeeded &= check(tree.name, path, exact, 1000000, INT_MAX, 0, 100, true);
+	}
+
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+#
+#  gen_name_index_tables.py
+#  FileDir
+#
+#  Generates FileDirNameIndexTables.h, the Unicode tables used by FileDirNameIndex,
+#  from the character database of the running Python's unicodedata module.
+#  To move to a newer Unicode version, run it with a Python that ships that version.
+#
+#  Usage: python3 tools/gen_name_index_tables.py [output path, default FileDirNameIndexTables.h next to tools/]
+#
+#  https://github.com/danielgindi/FileDir
+#
+#  The MIT License (MIT)
+#
+#  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+#
+
+import os
+import sys
+import unicodedata
+
+MAX_CODE_POINT = 0x110000
+
+BANNER = '''//
+//  FileDirNameIndexTables.h
+//  FileDir
+//
+//  Created by Daniel Cohen Gindi on 6/24/14.
+//  Copyright (c) 2013 Daniel Cohen Gindi. All rights reserved.
+//
+//  https://github.com/danielgindi/FileDir
+//
+//  The MIT License (MIT)
+//
+//  Copyright (c) 2014 Daniel Cohen Gindi (danielgindi@gmail.com)
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+'''
+
+
+def is_hangul(cp):
+    return 0xAC00 <= cp <= 0xD7A3
+
+
+def full_decomposition(cp):
+    """The fully expanded canonical decomposition of cp, or None if it has none (or is a Hangul syllable)."""
+    if is_hangul(cp):
+        return None
+    decomposition = unicodedata.decomposition(chr(cp))
+    if not decomposition or decomposition.startswith('<'):
+        return None
+    result = []
+    for part in decomposition.split():
+        c = int(part, 16)
+        expanded = full_decomposition(c)
+        result.extend(expanded if expanded else [c])
+    return result
+
+
+def collect():
+    decompositions = []
+    for cp in range(MAX_CODE_POINT):
+        d = full_decomposition(cp)
+        if d:
+            decompositions.append((cp, d))
+
+    case_foldings = []
+    for cp in range(MAX_CODE_POINT):
+        if 0xD800 <= cp <= 0xDFFF:
+            continue
+        folded = chr(cp).casefold()
+        if folded != chr(cp):
+            case_foldings.append((cp, [ord(c) for c in folded]))
+
+    combining_classes = []
+    for cp in range(MAX_CODE_POINT):
+        c = unicodedata.combining(chr(cp))
+        if not c:
+            continue
+        if combining_classes and combining_classes[-1][1] == cp - 1 and combining_classes[-1][2] == c:
+            combining_classes[-1][1] = cp
+        else:
+            combining_classes.append([cp, cp, c])
+
+    # Pairs of combining class 0 code points which NFC composes, e.g. the Tamil U+0BC6 U+0BBE.
+    # Keys are decomposed, so a first half which has a decomposition is listed by the last code point of it.
+    # Hangul jamo compose the same way, but algorithmically, so they are not listed.
+    composing_pairs = []
+    for cp in range(MAX_CODE_POINT):
+        decomposition = unicodedata.decomposition(chr(cp))
+        if not decomposition or decomposition.startswith('<'):
+            continue
+        parts = [int(part, 16) for part in decomposition.split()]
+        if len(parts) == 2 and unicodedata.normalize('NFC', chr(cp)) == chr(cp) and not unicodedata.combining(chr(parts[1])):
+            first = full_decomposition(parts[0])
+            composing_pairs.append((first[-1] if first else parts[0], parts[1]))
+
+    return decompositions, case_foldings, combining_classes, sorted(composing_pairs)
+
+
+def emit_mappings(name, pool_name, items, out):
+    pool = []
+    out.append('static const unicode_mapping_t %s[] = {' % name)
+    line = []
+    for cp, mapping in items:
+        line.append('{0x%04X,%d,%d}' % (cp, len(pool), len(mapping)))
+        pool.extend(mapping)
+        if len(line) == 6:
+            out.append('\t' + ', '.join(line) + ',')
+            line = []
+    if line:
+        out.append('\t' + ', '.join(line) + ',')
+    out.append('};')
+    out.append('')
+
+    # The C structs hold 16 bit offsets and 8 bit lengths
+    assert len(pool) < 0x10000 and max(len(m) for _, m in items) < 0x100
+
+    out.append('static const uint32_t %s[] = {' % pool_name)
+    for i in range(0, len(pool), 10):
+        out.append('\t' + ', '.join('0x%04X' % c for c in pool[i:i + 10]) + ',')
+    out.append('};')
+    out.append('')
+
+
+def generate():
+    decompositions, case_foldings, combining_classes, composing_pairs = collect()
+
+    out = [BANNER]
+    out.append('#pragma once')
+    out.append('')
+    out.append('// Generated from the Unicode %s character database, with Python\'s unicodedata module:' % unicodedata.unidata_version)
+    out.append('// - s_decompositions: code points with a canonical decomposition (not compatibility), fully expanded. Hangul syllables are')
+    out.append('//   decomposed algorithmically and are not listed.')
+    out.append('// - s_caseFoldings: full case folding (statuses C and F of CaseFolding.txt), i.e. str.casefold().')
+    out.append('// - s_combiningClasses: ranges of code points with a non zero canonical combining class.')
+    out.append('// - s_composingPairs: pairs of combining class 0 code points that NFC composes (Hangul jamo are not listed).')
+    out.append('// All tables are sorted by code point. Do not edit by hand, regenerate with tools/gen_name_index_tables.py.')
+    out.append('')
+    out.append('#include <stdint.h>')
+    out.append('')
+    out.append('typedef struct _unicode_mapping_t {')
+    out.append('\tuint32_t codePoint;')
+    out.append('\tuint16_t offset; // Into the table\'s code point pool')
+    out.append('\tuint8_t length;')
+    out.append('} unicode_mapping_t;')
+    out.append('')
+    out.append('typedef struct _unicode_class_range_t {')
+    out.append('\tuint32_t first;')
+    out.append('\tuint32_t last;')
+    out.append('\tuint8_t combiningClass;')
+    out.append('} unicode_class_range_t;')
+    out.append('')
+    out.append('typedef struct _unicode_pair_t {')
+    out.append('\tuint32_t first;')
+    out.append('\tuint32_t second;')
+    out.append('} unicode_pair_t;')
+    out.append('')
+    emit_mappings('s_decompositions', 's_decompositionCodePoints', decompositions, out)
+    emit_mappings('s_caseFoldings', 's_caseFoldingCodePoints', case_foldings, out)
+    out.append('static const unicode_class_range_t s_combiningClasses[] = {')
+    line = []
+    for first, last, c in combining_classes:
+        line.append('{0x%04X,0x%04X,%d}' % (first, last, c))
+        if len(line) == 5:
+            out.append('\t' + ', '.join(line) + ',')
+            line = []
+    if line:
+        out.append('\t' + ', '.join(line) + ',')
+    out.append('};')
+    out.append('')
+    out.append('static const unicode_pair_t s_composingPairs[] = {')
+    for i in range(0, len(composing_pairs), 6):
+        out.append('\t' + ', '.join('{0x%04X,0x%04X}' % pair for pair in composing_pairs[i:i + 6]) + ',')
+    out.append('};')
+    return '\n'.join(out) + '\n'
+
+
+def main():
+    if len(sys.argv) > 1:
+        path = sys.argv[1]
+    else:
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'FileDirNameIndexTables.h')
+
+    # The sources use CRLF line endings
+    with open(path, 'w', newline='\r\n') as f:
+        f.write(generate())
+
+
+if __name__ == '__main__':
+    main()